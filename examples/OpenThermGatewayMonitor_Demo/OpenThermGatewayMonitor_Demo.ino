@@ -7,6 +7,8 @@ http://ihormelnyk.com
 
 #include <Arduino.h>
 #include <OpenTherm.h>
+#include <OpenThermGateway.h>
+#include <OpenThermOtgw.h>
 
 const int mInPin = 2;  // for Arduino, 4 for ESP8266 (D2), 21 for ESP32
 const int mOutPin = 4; // for Arduino, 5 for ESP8266 (D1), 22 for ESP32
@@ -14,38 +16,45 @@ const int mOutPin = 4; // for Arduino, 5 for ESP8266 (D1), 22 for ESP32
 const int sInPin = 3;  // for Arduino, 12 for ESP8266 (D6), 19 for ESP32
 const int sOutPin = 5; // for Arduino, 13 for ESP8266 (D7), 23 for ESP32
 
-OpenTherm mOT(mInPin, mOutPin);
-OpenTherm sOT(sInPin, sOutPin, true);
+OpenThermGateway gateway(mInPin, mOutPin, sInPin, sOutPin);
+
+char outputBuffer[128];
+OpenThermOtgwWriter output(outputBuffer, sizeof(outputBuffer)); // T/B/R/A lines for OpenTherm Monitor App
+OpenThermOtgwParser commands; // e.g. CS=60 to override CH water setpoint, CS=0 to cancel
 
 void IRAM_ATTR mHandleInterrupt()
 {
-    mOT.handleInterrupt();
+    gateway.master.handleInterrupt();
 }
 
 void IRAM_ATTR sHandleInterrupt()
 {
-    sOT.handleInterrupt();
-}
-
-void processRequest(unsigned long request, OpenThermResponseStatus status)
-{
-    Serial.println("T" + String(request, HEX)); // master/thermostat request
-    unsigned long response = mOT.sendRequest(request);
-    if (response)
-    {
-        Serial.println("B" + String(response, HEX)); // slave/boiler response
-        sOT.sendResponse(response);
-    }
+    gateway.slave.handleInterrupt();
 }
 
 void setup()
 {
-    Serial.begin(9600);          // 9600 supported by OpenTherm Monitor App
-    mOT.begin(mHandleInterrupt); // for ESP ot.begin(); without interrupt handler can be used
-    sOT.begin(sHandleInterrupt, processRequest);
+    Serial.begin(9600); // 9600 supported by OpenTherm Monitor App
+    gateway.begin(mHandleInterrupt, sHandleInterrupt); // for ESP gateway.begin(); without interrupt handlers can be used
+    gateway.setFrameHandler(OpenThermOtgwWriter::handleFrame, &output);
+    // gateway.setCacheMaxAge(5000); // answer thermostat reads from cache when boiler value is fresh
+    // gateway.clampValue(OpenThermMessageID::TSet, 20, 60); // limit CH water setpoint
 }
 
 void loop()
 {
-    sOT.process();
+    gateway.process();
+    while (Serial.available() > 0)
+    {
+        OpenThermOtgwStatus status = commands.feed(Serial.read());
+        if (status == OpenThermOtgwStatus::COMMAND)
+        {
+            status = OpenThermOtgwParser::apply(gateway, commands.getCommand());
+        }
+        if (status != OpenThermOtgwStatus::NONE)
+        {
+            output.writeReply(status, commands.getCommand());
+        }
+    }
+    output.flush(Serial); // doesn't wait for serial port
 }
@@ -7,69 +7,37 @@ http://ihormelnyk.com
 
 #include <Arduino.h>
 #include <OpenTherm.h>
+#include <OpenThermSlave.h>
 
 const int inPin = 2;  // for Arduino, 12 for ESP8266 (D6), 19 for ESP32
 const int outPin = 3; // for Arduino, 13 for ESP8266 (D7), 23 for ESP32
 OpenTherm ot(inPin, outPin, true);
+OpenThermSlave slave(ot);
 
 void IRAM_ATTR handleInterrupt()
 {
     ot.handleInterrupt();
 }
 
-void processRequest(unsigned long request, OpenThermResponseStatus status)
+// Status is handled by function, other supported IDs are answered from data table
+OpenThermMessageType handleStatus(OpenThermMessageType type, OpenThermMessageID id, uint16_t &data, void *context)
 {
-    Serial.println("T" + String(request, HEX)); // master/thermostat request
-
-    unsigned long response = 0;
-    OpenThermMessageID id = ot.getDataID(request);
-    uint16_t data = ot.getUInt(request);
-    float f = ot.getFloat(request);
-    switch (id)
-    {
-    case OpenThermMessageID::Status:
-    {
-        uint8_t statusRequest = data >> 8;
-        uint8_t chEnable = statusRequest & 0x1;
-        uint8_t dhwEnable = statusRequest & 0x2;
-        data &= 0xFF00;
-        // data |= 0x01; //fault indication
-        if (chEnable)
-            data |= 0x02; // CH active
-        if (dhwEnable)
-            data |= 0x04; // DHW active
-        if (chEnable || dhwEnable)
-            data |= 0x08; // flame on
-        // data |= 0x10; //cooling active
-        // data |= 0x20; //CH2 active
-        // data |= 0x40; //diagnostic/service event
-        // data |= 0x80; //electricity production on
-
-        response = ot.buildResponse(OpenThermMessageType::READ_ACK, id, data);
-        break;
-    }
-    case OpenThermMessageID::TSet:
-    {
-        response = ot.buildResponse(OpenThermMessageType::WRITE_ACK, id, data);
-        break;
-    }
-    case OpenThermMessageID::Tboiler:
-    {
-        data = ot.temperatureToData(45);
-        response = ot.buildResponse(OpenThermMessageType::READ_ACK, id, data);
-        break;
-    }
-    default:
-    {
-        // build UNKNOWN-DATAID response
-        response = ot.buildResponse(OpenThermMessageType::UNKNOWN_DATA_ID, ot.getDataID(request), 0);
-    }
-    }
-    Serial.println("B" + String(response, HEX)); // slave/boiler response
-
-    // send response
-    delay(20); // 20..400ms, usually 100ms
-    ot.sendResponse(response);
+    uint8_t statusRequest = data >> 8;
+    uint8_t chEnable = statusRequest & 0x1;
+    uint8_t dhwEnable = statusRequest & 0x2;
+    data &= 0xFF00;
+    // data |= 0x01; //fault indication
+    if (chEnable)
+        data |= 0x02; // CH active
+    if (dhwEnable)
+        data |= 0x04; // DHW active
+    if (chEnable || dhwEnable)
+        data |= 0x08; // flame on
+    // data |= 0x10; //cooling active
+    // data |= 0x20; //CH2 active
+    // data |= 0x40; //diagnostic/service event
+    // data |= 0x80; //electricity production on
+    return OpenThermMessageType::READ_ACK;
 }
 
 void setup()
@@ -77,10 +45,25 @@ void setup()
     Serial.begin(9600);
     Serial.println("Start");
 
-    ot.begin(handleInterrupt, processRequest); // for ESP ot.begin(); without interrupt handler can be used
+    ot.begin(handleInterrupt); // for ESP ot.begin(); without interrupt handler can be used
+    slave.begin();
+
+    slave.setHandler(handleStatus);
+    slave.setValue(OpenThermMessageID::Status, 0);
+    slave.enableHandler(OpenThermMessageID::Status);
+    slave.setFloat(OpenThermMessageID::TSet, 0, OpenThermDataAccess::WRITE);
+    slave.setFloat(OpenThermMessageID::Tboiler, 45);
 }
 
 void loop()
 {
-    ot.process();
+    slave.process();
+
+    static unsigned long lastPrint = 0;
+    if (millis() - lastPrint > 10000)
+    {
+        lastPrint = millis();
+        Serial.println("TSet: " + String(slave.getFloat(OpenThermMessageID::TSet)));
+        Serial.println("Response latency us, avg: " + String(slave.getAverageLatency()) + ", max: " + String(slave.getMaxLatency()));
+    }
 }
@@ -4,7 +4,10 @@ Copyright 2023, Ihor Melnyk
 */
 
 #include "OpenTherm.h"
-#if !defined(__AVR__)
+#include "OpenThermTrace.h"
+#include "OpenThermFuture.h"
+#include "OpenThermCodec.h"
+#if !defined(__AVR__) && !defined(OPENTHERM_HOST)
 #include "FunctionalInterrupt.h"
 #endif
 
@@ -12,18 +15,83 @@ OpenTherm::OpenTherm(int inPin, int outPin, bool isSlave) :
     status(OpenThermStatus::NOT_INITIALIZED),
     inPin(inPin),
     outPin(outPin),
+#if OPENTHERM_SLAVE
     isSlave(isSlave),
+#endif
     response(0),
     responseStatus(OpenThermResponseStatus::NONE),
     responseTimestamp(0),
-    processResponseCallback(NULL)
+    responseLatency(0),
+    responseLatencyPeak(0),
+    startTimerCallback(NULL),
+    stopTimerCallback(NULL),
+    sharedTimer(false),
+    txFrame(0),
+    txBitIndex(0),
+#if OPENTHERM_EDGE_BUFFER_SIZE > 0
+    deferredReceive(false),
+    edgeHead(0),
+    edgeTail(0),
+    edgeOverflows(0),
+    processedEdgeOverflows(0),
+#endif
+    queueHead(0),
+    queueCount(0),
+    queueMaxCount(0),
+    queueDrops(0),
+    queuePaused(false),
+    activeHandler(NULL),
+    activeContext(NULL),
+    activeAttempt(0),
+    listeners(NULL),
+    cacheMaxAge(0),
+    writeRefresh(0),
+    writesSkipped(0),
+    lastRequest(0),
+#if OPENTHERM_DISCOVERY
+    discoveryIndex(-1),
+    discoveryStarted(false),
+    slaveConfig(-1),
+#endif
+    stats(NULL),
+    statsSequence(0),
+    requestTimestamp(0),
+    conversationEndTimestamp(0),
+    trace(NULL)
+#ifdef INC_FREERTOS_H
+    , notifyTask(NULL)
+#endif
+#if OPENTHERM_CALLBACKS
+    , processResponseCallback(NULL)
+#endif
 {
+#if !OPENTHERM_SLAVE
+    (void)isSlave;
+#endif
+    for (byte i = 0; i < OPENTHERM_RETRY_OVERRIDES; i++)
+    {
+        retryOverrides[i].used = false;
+    }
+    clearCache();
+    clearWriteCache();
+#if OPENTHERM_DISCOVERY
+    clearIdSupport();
+#endif
 }
 
 void OpenTherm::begin(void (*handleInterruptCallback)(void))
+{
+    attach(handleInterruptCallback);
+    activateBoiler();
+    status = OpenThermStatus::READY;
+}
+
+void OpenTherm::attach(void (*handleInterruptCallback)(void))
 {
     pinMode(inPin, INPUT);
     pinMode(outPin, OUTPUT);
+    inPinIo.begin(inPin);
+    outPinIo.begin(outPin);
     if (handleInterruptCallback != NULL)
     {
         attachInterrupt(digitalPinToInterrupt(inPin), handleInterruptCallback, CHANGE);
@@ -39,15 +107,15 @@ void OpenTherm::begin(void (*handleInterruptCallback)(void))
         );
 #endif
     }
-    activateBoiler();
-    status = OpenThermStatus::READY;
 }
 
+#if OPENTHERM_CALLBACKS
 void OpenTherm::begin(void (*handleInterruptCallback)(void), void (*processResponseCallback)(unsigned long, OpenThermResponseStatus))
 {
     begin(handleInterruptCallback);
     this->processResponseCallback = processResponseCallback;
 }
+#endif
 
 #if !defined(__AVR__)
 void OpenTherm::begin()
@@ -55,12 +123,20 @@ void OpenTherm::begin()
     begin(NULL);
 }
 
+#if OPENTHERM_CALLBACKS
 void OpenTherm::begin(std::function<void(unsigned long, OpenThermResponseStatus)> processResponseFunction)
 {
     begin();
     this->processResponseFunction = processResponseFunction;
 }
 #endif
+#endif
+
+void OpenTherm::setTransmitTimer(void (*startTimerCallback)(void), void (*stopTimerCallback)(void))
+{
+    this->startTimerCallback = startTimerCallback;
+    this->stopTimerCallback = stopTimerCallback;
+}
 
 bool IRAM_ATTR OpenTherm::isReady()
 {
@@ -69,17 +145,17 @@ bool IRAM_ATTR OpenTherm::isReady()
 
 int IRAM_ATTR OpenTherm::readState()
 {
-    return digitalRead(inPin);
+    return inPinIo.read();
 }
 
-void OpenTherm::setActiveState()
+void IRAM_ATTR OpenTherm::setActiveState()
 {
-    digitalWrite(outPin, LOW);
+    outPinIo.write(LOW);
 }
 
-void OpenTherm::setIdleState()
+void IRAM_ATTR OpenTherm::setIdleState()
 {
-    digitalWrite(outPin, HIGH);
+    outPinIo.write(HIGH);
 }
 
 void OpenTherm::activateBoiler()
@@ -113,9 +189,17 @@ bool OpenTherm::sendRequestAsync(unsigned long request)
         return false;
     }
 
-    status = OpenThermStatus::REQUEST_SENDING;
     response = 0;
     responseStatus = OpenThermResponseStatus::NONE;
+    lastRequest = request;
+    recordFrameSent(request);
+
+    if (startTimerCallback != NULL)
+    {
+        return sendFrame(request);
+    }
+
+    status = OpenThermStatus::REQUEST_SENDING;
 
 #ifdef INC_FREERTOS_H
     BaseType_t schedulerState = xTaskGetSchedulerState();
@@ -135,7 +219,7 @@ bool OpenTherm::sendRequestAsync(unsigned long request)
     sendBit(HIGH); // stop bit
     setIdleState();
 
-    responseTimestamp = micros();
+    responseTimestamp = openThermMicros();
     status = OpenThermStatus::RESPONSE_WAITING;
 
 #ifdef INC_FREERTOS_H
@@ -147,6 +231,68 @@ bool OpenTherm::sendRequestAsync(unsigned long request)
     return true;
 }
 
+// Starts a timer-driven transmission, must be called with interrupts disabled.
+// The frame is clocked out half a bit at a time from handleTimerInterrupt().
+bool OpenTherm::sendFrame(unsigned long frame)
+{
+    txFrame = frame;
+    if (sharedTimer)
+    {
+        // timer may be already running for other instances, frame starts on its next tick
+        txBitIndex = 0xFF;
+        status = OpenThermStatus::REQUEST_SENDING_SECOND_HALF;
+    }
+    else
+    {
+        txBitIndex = 0;
+        status = OpenThermStatus::REQUEST_SENDING_FIRST_HALF;
+        sendHalfBit(true);
+    }
+    responseTimestamp = openThermMicros();
+    interrupts();
+
+    startTimerCallback();
+    return true;
+}
+
+void IRAM_ATTR OpenTherm::sendHalfBit(bool firstHalf)
+{
+    // start and stop bits are 1, data bits are sent MSB first
+    const bool high = (txBitIndex == 0 || txBitIndex == 33) ? true : bitRead(txFrame, 32 - txBitIndex);
+    if (high == firstHalf)
+        setActiveState();
+    else
+        setIdleState();
+}
+
+void IRAM_ATTR OpenTherm::handleTimerInterrupt()
+{
+    if (status == OpenThermStatus::REQUEST_SENDING_FIRST_HALF)
+    {
+        sendHalfBit(false);
+        status = OpenThermStatus::REQUEST_SENDING_SECOND_HALF;
+    }
+    else if (status == OpenThermStatus::REQUEST_SENDING_SECOND_HALF)
+    {
+        txBitIndex = txBitIndex + 1;
+        if (txBitIndex < 34)
+        {
+            sendHalfBit(true);
+            status = OpenThermStatus::REQUEST_SENDING_FIRST_HALF;
+        }
+        else
+        {
+            setIdleState();
+            if (stopTimerCallback != NULL)
+            {
+                stopTimerCallback();
+            }
+            responseTimestamp = openThermMicros();
+            status = isSlave ? OpenThermStatus::READY : OpenThermStatus::RESPONSE_WAITING;
+        }
+    }
+}
+
 unsigned long OpenTherm::sendRequest(unsigned long request)
 {
     if (!sendRequestAsync(request))
@@ -154,14 +300,37 @@ unsigned long OpenTherm::sendRequest(unsigned long request)
         return 0;
     }
 
-    while (!isReady())
+    // queued requests must not be sent before this response is returned
+    queuePaused = true;
+    for (byte attempt = 1;; attempt++)
     {
-        process();
-        yield();
+        while (!isReady())
+        {
+            process();
+            yield();
+        }
+        if (!shouldRetry(request, response, responseStatus, attempt))
+        {
+            break;
+        }
+        const unsigned long delayStart = millis();
+        const unsigned long retryDelay = getRetryDelay(request, attempt);
+        while (millis() - delayStart < retryDelay)
+        {
+            process();
+            yield();
+        }
+        recordRetry();
+        if (!sendRequestAsync(request))
+        {
+            break;
+        }
     }
+    queuePaused = false;
     return response;
 }
 
+#if OPENTHERM_SLAVE
 bool OpenTherm::sendResponse(unsigned long request)
 {
     noInterrupts();
@@ -173,9 +342,16 @@ bool OpenTherm::sendResponse(unsigned long request)
         return false;
     }
 
-    status = OpenThermStatus::REQUEST_SENDING;
     response = 0;
     responseStatus = OpenThermResponseStatus::NONE;
+    recordFrameSent(request);
+
+    if (startTimerCallback != NULL)
+    {
+        return sendFrame(request);
+    }
+
+    status = OpenThermStatus::REQUEST_SENDING;
 
 #ifdef INC_FREERTOS_H
     BaseType_t schedulerState = xTaskGetSchedulerState();
@@ -197,29 +373,740 @@ bool OpenTherm::sendResponse(unsigned long request)
     status = OpenThermStatus::READY;
 
 #ifdef INC_FREERTOS_H
-    if (schedulerState == taskSCHEDULER_RUNNING) {
-        xTaskResumeAll();
+    if (schedulerState == taskSCHEDULER_RUNNING) {
+        xTaskResumeAll();
+    }
+#endif
+
+    return true;
+}
+#endif
+
+void OpenTherm::addResponseListener(OpenThermResponseListener *listener)
+{
+    listener->next = listeners;
+    listeners = listener;
+}
+
+void OpenTherm::removeResponseListener(OpenThermResponseListener *listener)
+{
+    for (OpenThermResponseListener **it = &listeners; *it != NULL; it = &(*it)->next)
+    {
+        if (*it == listener)
+        {
+            *it = listener->next;
+            listener->next = NULL;
+            return;
+        }
+    }
+}
+
+bool OpenTherm::enqueueRequest(unsigned long request, OpenThermResponseHandler handler, void *context)
+{
+    return enqueue(request, handler, context, false);
+}
+
+bool OpenTherm::enqueue(unsigned long request, OpenThermResponseHandler handler, void *context, bool coalesce)
+{
+    if (queueCount >= OPENTHERM_REQUEST_QUEUE_SIZE)
+    {
+        queueDrops++;
+        return false;
+    }
+
+    QueuedRequest &entry = queue[(queueHead + queueCount) % OPENTHERM_REQUEST_QUEUE_SIZE];
+    entry.request = request;
+    entry.handler = handler;
+    entry.context = context;
+    entry.attempt = 1;
+    entry.notBefore = 0;
+    entry.coalesce = coalesce;
+    queueCount++;
+    if (queueCount > queueMaxCount)
+    {
+        queueMaxCount = queueCount;
+    }
+
+    sendQueuedRequest();
+    return true;
+}
+
+bool OpenTherm::sendRequestAsync(unsigned long request, OpenThermFuture &future)
+{
+    if (future.isPending())
+    {
+        return false;
+    }
+    future.start();
+    if (!enqueueRequest(request, OpenThermFuture::complete, &future))
+    {
+        future.complete(0, OpenThermResponseStatus::NONE, &future);
+        return false;
+    }
+    return true;
+}
+
+#if OPENTHERM_COROUTINES
+OpenThermAwaitable OpenTherm::read(OpenThermMessageID id)
+{
+    return OpenThermAwaitable(*this, buildRequest(OpenThermMessageType::READ_DATA, id, 0));
+}
+
+OpenThermAwaitable OpenTherm::write(OpenThermMessageID id, unsigned int data)
+{
+    return OpenThermAwaitable(*this, buildRequest(OpenThermMessageType::WRITE_DATA, id, data));
+}
+#endif
+
+byte OpenTherm::getQueueDepth()
+{
+    return queueCount;
+}
+
+byte OpenTherm::getMaxQueueDepth()
+{
+    return queueMaxCount;
+}
+
+unsigned long OpenTherm::getQueueDrops()
+{
+    return queueDrops;
+}
+
+void OpenTherm::sendQueuedRequest()
+{
+    if (queueCount == 0 || queuePaused || !isReady() || getQueueDelay() > 0)
+    {
+        return;
+    }
+
+    const QueuedRequest &entry = queue[queueHead];
+    queueHead = (queueHead + 1) % OPENTHERM_REQUEST_QUEUE_SIZE;
+    queueCount--;
+
+    activeHandler = entry.handler;
+    activeContext = entry.context;
+    activeAttempt = entry.attempt;
+    if (entry.attempt > 1)
+    {
+        recordRetry();
+    }
+    if (!sendRequestAsync(entry.request))
+    {
+        activeHandler = NULL;
+        activeAttempt = 0;
+        if (entry.handler != NULL)
+        {
+            entry.handler(0, OpenThermResponseStatus::NONE, entry.context);
+        }
+    }
+}
+
+bool OpenTherm::enqueueWrite(OpenThermMessageID id, unsigned int data, OpenThermResponseHandler handler, void *context)
+{
+    const OpenThermMessageType type = id == OpenThermMessageID::Status ? OpenThermMessageType::READ_DATA : OpenThermMessageType::WRITE_DATA;
+    const unsigned long request = buildRequest(type, id, data);
+
+    // only the latest value of a data ID waiting in the queue is sent, requests queued
+    // by enqueueRequest, e.g. forwarded by the gateway, expect their own answer
+    for (byte i = 0; i < queueCount; i++)
+    {
+        QueuedRequest &entry = queue[(queueHead + i) % OPENTHERM_REQUEST_QUEUE_SIZE];
+        if (!entry.coalesce || getDataID(entry.request) != id || getMessageType(entry.request) != type)
+        {
+            continue;
+        }
+        const OpenThermResponseHandler superseded = entry.handler;
+        void *supersededContext = entry.context;
+        entry.request = request;
+        entry.handler = handler;
+        entry.context = context;
+        entry.attempt = 1;
+        writesSkipped++;
+        if (superseded != NULL)
+        {
+            superseded(0, OpenThermResponseStatus::NONE, supersededContext);
+        }
+        return true;
+    }
+
+    unsigned long response;
+    if (getWrittenResponse(request, response))
+    {
+        writesSkipped++;
+        if (handler != NULL)
+        {
+            handler(response, OpenThermResponseStatus::SUCCESS, context);
+        }
+        return true;
+    }
+    return enqueue(request, handler, context, true);
+}
+
+// ms until the request at the head of the queue may be sent
+unsigned long OpenTherm::getQueueDelay()
+{
+    if (queueCount == 0 || queue[queueHead].attempt <= 1)
+    {
+        return 0;
+    }
+    const long remaining = (long)(queue[queueHead].notBefore - millis());
+    return remaining > 0 ? remaining : 0;
+}
+
+// puts the request in progress back to the head of the queue
+bool OpenTherm::retryQueuedRequest(byte attempt)
+{
+    if (queueCount >= OPENTHERM_REQUEST_QUEUE_SIZE)
+    {
+        return false;
+    }
+    queueHead = (queueHead + OPENTHERM_REQUEST_QUEUE_SIZE - 1) % OPENTHERM_REQUEST_QUEUE_SIZE;
+    queueCount++;
+    QueuedRequest &entry = queue[queueHead];
+    entry.request = lastRequest;
+    entry.handler = activeHandler;
+    entry.context = activeContext;
+    entry.attempt = attempt + 1;
+    entry.notBefore = millis() + getRetryDelay(lastRequest, attempt);
+    // a newer value is queued after the retry instead of replacing it
+    entry.coalesce = false;
+    return true;
+}
+
+void OpenTherm::setRetryPolicy(const OpenThermRetryPolicy &policy)
+{
+    retryPolicy = policy;
+}
+
+bool OpenTherm::setRetryPolicy(OpenThermMessageID id, const OpenThermRetryPolicy &policy)
+{
+    int index = -1;
+    for (byte i = 0; i < OPENTHERM_RETRY_OVERRIDES; i++)
+    {
+        if (retryOverrides[i].used && retryOverrides[i].id == id)
+        {
+            index = i;
+            break;
+        }
+        if (!retryOverrides[i].used && index < 0)
+        {
+            index = i;
+        }
+    }
+    if (index < 0)
+    {
+        return false;
+    }
+    retryOverrides[index].id = id;
+    retryOverrides[index].policy = policy;
+    retryOverrides[index].used = true;
+    return true;
+}
+
+void OpenTherm::clearRetryPolicy(OpenThermMessageID id)
+{
+    for (byte i = 0; i < OPENTHERM_RETRY_OVERRIDES; i++)
+    {
+        if (retryOverrides[i].id == id)
+        {
+            retryOverrides[i].used = false;
+        }
+    }
+}
+
+const OpenThermRetryPolicy &OpenTherm::getRetryPolicy(OpenThermMessageID id)
+{
+    for (byte i = 0; i < OPENTHERM_RETRY_OVERRIDES; i++)
+    {
+        if (retryOverrides[i].used && retryOverrides[i].id == id)
+        {
+            return retryOverrides[i].policy;
+        }
+    }
+    return retryPolicy;
+}
+
+bool OpenTherm::shouldRetry(unsigned long request, unsigned long response, OpenThermResponseStatus status, byte attempt)
+{
+    if (isSlave || attempt >= getRetryPolicy(getDataID(request)).maxAttempts)
+    {
+        return false;
+    }
+    if (status == OpenThermResponseStatus::INVALID && !parity(response) && getDataID(response) == getDataID(request))
+    {
+        // the slave has answered, repeating the request would give the same answer
+        const OpenThermMessageType type = getMessageType(response);
+        if (type == OpenThermMessageType::DATA_INVALID || type == OpenThermMessageType::UNKNOWN_DATA_ID)
+        {
+            return false;
+        }
+    }
+    else if (status != OpenThermResponseStatus::TIMEOUT && status != OpenThermResponseStatus::INVALID)
+    {
+        return false;
+    }
+    if (getMessageType(request) == OpenThermMessageType::WRITE_DATA)
+    {
+        // a command may have been executed even if its acknowledgement was lost
+        return getRetryPolicy(getDataID(request)).retryWrites && getDataID(request) != OpenThermMessageID::RemoteRequest;
+    }
+    return true;
+}
+
+unsigned long OpenTherm::getRetryDelay(unsigned long request, byte attempt)
+{
+    const OpenThermRetryPolicy &policy = getRetryPolicy(getDataID(request));
+    unsigned long delay = policy.backoff;
+    for (byte i = 1; i < attempt && delay < policy.maxBackoff; i++)
+    {
+        delay <<= 1;
+    }
+    return delay < policy.maxBackoff ? delay : policy.maxBackoff;
+}
+
+unsigned long OpenTherm::getLastResponse()
+{
+    return response;
+}
+
+// end of last received frame in micros, valid until the next frame is sent
+unsigned long OpenTherm::getLastFrameTimestamp()
+{
+    return responseTimestamp;
+}
+
+void OpenTherm::setCacheMaxAge(unsigned long maxAge)
+{
+    cacheMaxAge = maxAge;
+}
+
+bool OpenTherm::getCachedResponse(OpenThermMessageID id, unsigned long &response, unsigned long maxAge)
+{
+    const unsigned long now = millis();
+    for (byte i = 0; i < OPENTHERM_CACHE_SIZE; i++)
+    {
+        // READ_ACK frame is never 0, so 0 marks an empty entry
+        if (cache[i].response != 0 && getDataID(cache[i].response) == id)
+        {
+            if (now - cache[i].timestamp > maxAge)
+            {
+                return false;
+            }
+            response = cache[i].response;
+            return true;
+        }
+    }
+    return false;
+}
+
+void OpenTherm::clearCache()
+{
+    for (byte i = 0; i < OPENTHERM_CACHE_SIZE; i++)
+    {
+        cache[i].response = 0;
+        cache[i].timestamp = 0;
+    }
+}
+
+bool OpenTherm::isCacheable(OpenThermMessageID id)
+{
+    switch (id)
+    {
+    case OpenThermMessageID::Status:
+    case OpenThermMessageID::StatusVentilationHeatRecovery:
+    case OpenThermMessageID::StatusSolarStorage:
+    case OpenThermMessageID::TSPindexTSPvalue:
+    case OpenThermMessageID::FHBindexFHBvalue:
+    case OpenThermMessageID::TSPindexTSPvalueVentilationHeatRecovery:
+    case OpenThermMessageID::FHBindexFHBvalueVentilationHeatRecovery:
+    case OpenThermMessageID::TSPindexTSPvalueSolarStorage:
+    case OpenThermMessageID::FHBindexFHBvalueSolarStorage:
+    case OpenThermMessageID::Brand:
+    case OpenThermMessageID::BrandVersion:
+    case OpenThermMessageID::BrandSerialNumber:
+        return false;
+    default:
+        return true;
+    }
+}
+
+void OpenTherm::cacheResponse(unsigned long response)
+{
+    const OpenThermMessageID id = getDataID(response);
+    if (!isCacheable(id))
+    {
+        return;
+    }
+    const unsigned long now = millis();
+    byte index = 0;
+    for (byte i = 0; i < OPENTHERM_CACHE_SIZE; i++)
+    {
+        if (cache[i].response == 0 || getDataID(cache[i].response) == id)
+        {
+            index = i;
+            break;
+        }
+        // replace the oldest entry if there is no free one
+        if (now - cache[i].timestamp > now - cache[index].timestamp)
+        {
+            index = i;
+        }
+    }
+    cache[index].response = response;
+    cache[index].timestamp = now;
+}
+
+// Writes and Status requests set slave state, repeating them with the same data changes nothing
+bool OpenTherm::isCommand(unsigned long request)
+{
+    return getMessageType(request) == OpenThermMessageType::WRITE_DATA || getDataID(request) == OpenThermMessageID::Status;
+}
+
+// When refresh (ms) is set, commands identical to the last acknowledged one are not sent again within it.
+// Status is still sent at least every OPENTHERM_STATUS_MAX_PERIOD ms.
+void OpenTherm::setWriteRefresh(unsigned long refresh)
+{
+    writeRefresh = refresh;
+}
+
+unsigned long OpenTherm::getWritesSkipped()
+{
+    return writesSkipped;
+}
+
+void OpenTherm::clearWriteCache()
+{
+    for (byte i = 0; i < OPENTHERM_WRITE_CACHE_SIZE; i++)
+    {
+        writeCache[i].request = 0;
+        writeCache[i].response = 0;
+        writeCache[i].timestamp = 0;
+    }
+}
+
+void OpenTherm::recordWrite(unsigned long request, unsigned long response, OpenThermResponseStatus status)
+{
+    const OpenThermMessageID id = getDataID(request);
+    const unsigned long now = millis();
+    byte index = 0;
+    bool found = false;
+    for (byte i = 0; i < OPENTHERM_WRITE_CACHE_SIZE; i++)
+    {
+        if (writeCache[i].response != 0 && getDataID(writeCache[i].request) == id)
+        {
+            index = i;
+            found = true;
+            break;
+        }
+        // otherwise use a free entry or replace the oldest one
+        if (writeCache[index].response != 0 && (writeCache[i].response == 0 || now - writeCache[i].timestamp > now - writeCache[index].timestamp))
+        {
+            index = i;
+        }
+    }
+    if (status != OpenThermResponseStatus::SUCCESS)
+    {
+        // the slave may or may not have applied it
+        if (found)
+        {
+            writeCache[index].response = 0;
+        }
+        return;
+    }
+    writeCache[index].request = request;
+    writeCache[index].response = response;
+    writeCache[index].timestamp = now;
+}
+
+bool OpenTherm::getWrittenResponse(unsigned long request, unsigned long &response)
+{
+    if (writeRefresh == 0)
+    {
+        return false;
+    }
+    unsigned long refresh = writeRefresh;
+    if (getDataID(request) == OpenThermMessageID::Status && refresh > OPENTHERM_STATUS_MAX_PERIOD)
+    {
+        refresh = OPENTHERM_STATUS_MAX_PERIOD;
+    }
+    for (byte i = 0; i < OPENTHERM_WRITE_CACHE_SIZE; i++)
+    {
+        if (writeCache[i].response != 0 && writeCache[i].request == request)
+        {
+            if (millis() - writeCache[i].timestamp >= refresh)
+            {
+                return false;
+            }
+            response = writeCache[i].response;
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned long OpenTherm::readData(OpenThermMessageID id)
+{
+    unsigned long response;
+    readData(id, response);
+    return response;
+}
+
+OpenThermResponseStatus OpenTherm::readData(OpenThermMessageID id, unsigned long &response)
+{
+    response = 0;
+    if (!isIdSupported(id))
+    {
+        return OpenThermResponseStatus::INVALID;
+    }
+    if (cacheMaxAge > 0 && getCachedResponse(id, response, cacheMaxAge))
+    {
+        return OpenThermResponseStatus::SUCCESS;
+    }
+    if (!isReady())
+    {
+        return OpenThermResponseStatus::NONE;
+    }
+    response = sendRequest(buildRequest(OpenThermMessageType::READ_DATA, id, 0));
+    return responseStatus;
+}
+
+OpenThermResponseStatus OpenTherm::writeData(OpenThermMessageID id, unsigned int data, unsigned long &response)
+{
+    response = 0;
+    if (!isIdSupported(id, OpenThermMessageType::WRITE_DATA))
+    {
+        return OpenThermResponseStatus::INVALID;
+    }
+    const unsigned long request = buildRequest(OpenThermMessageType::WRITE_DATA, id, data);
+    if (getWrittenResponse(request, response))
+    {
+        writesSkipped++;
+        return OpenThermResponseStatus::SUCCESS;
+    }
+    if (!isReady())
+    {
+        return OpenThermResponseStatus::NONE;
+    }
+    response = sendRequest(request);
+    return responseStatus;
+}
+
+// true unless the slave has answered UNKNOWN_DATA_ID to this request type
+bool OpenTherm::isIdSupported(OpenThermMessageID id, OpenThermMessageType type)
+{
+#if OPENTHERM_DISCOVERY
+    return getIdSupport(id, type) != OpenThermIdSupport::UNSUPPORTED;
+#else
+    (void)id;
+    (void)type;
+    return true;
+#endif
+}
+
+#if OPENTHERM_DISCOVERY
+static bool bitmapRead(const byte *bitmap, byte bit)
+{
+    return bitmap[bit >> 3] & (1 << (bit & 7));
+}
+
+static void bitmapWrite(byte *bitmap, byte bit, bool value)
+{
+    if (value)
+        bitmap[bit >> 3] |= 1 << (bit & 7);
+    else
+        bitmap[bit >> 3] &= ~(1 << (bit & 7));
+}
+
+OpenThermIdSupport OpenTherm::getIdSupport(OpenThermMessageID id, OpenThermMessageType type)
+{
+    const bool write = type == OpenThermMessageType::WRITE_DATA;
+    if (!bitmapRead(write ? writeKnown : readKnown, (byte)id))
+    {
+        return OpenThermIdSupport::UNKNOWN;
+    }
+    return bitmapRead(write ? writeSupported : readSupported, (byte)id) ? OpenThermIdSupport::SUPPORTED : OpenThermIdSupport::UNSUPPORTED;
+}
+
+void OpenTherm::clearIdSupport()
+{
+    memset(readKnown, 0, sizeof(readKnown));
+    memset(readSupported, 0, sizeof(readSupported));
+    memset(writeKnown, 0, sizeof(writeKnown));
+    memset(writeSupported, 0, sizeof(writeSupported));
+    slaveConfig = -1;
+}
+
+// Probes every readable data ID known to the codec, one request at a time from process()
+// when the bus is idle and nothing else is queued, so other users of the bus go first.
+// Status is not probed, its request data would change master status flags.
+void OpenTherm::startDiscovery()
+{
+    discoveryIndex = 0;
+    discoveryStarted = true;
+}
+
+bool OpenTherm::isDiscovering()
+{
+    return discoveryIndex >= 0;
+}
+
+void OpenTherm::probeNextId()
+{
+    if (discoveryIndex < 0 || queueCount > 0 || !isReady())
+    {
+        return;
+    }
+    while (discoveryIndex < OpenThermCodec::getDescriptorCount())
+    {
+        const OpenThermDataDescriptor descriptor = OpenThermCodec::getDescriptor(discoveryIndex++);
+        if (descriptor.id == OpenThermMessageID::Status ||
+            ((byte)descriptor.access & (byte)OpenThermDataAccess::READ) == 0 ||
+            bitmapRead(readKnown, (byte)descriptor.id))
+        {
+            continue;
+        }
+        enqueueRequest(buildRequest(OpenThermMessageType::READ_DATA, descriptor.id, 0));
+        return;
+    }
+    discoveryIndex = -1;
+}
+
+void OpenTherm::learnIdSupport(unsigned long response)
+{
+    if (responseStatus == OpenThermResponseStatus::TIMEOUT || responseStatus == OpenThermResponseStatus::NONE || parity(response))
+    {
+        return;
+    }
+    const OpenThermMessageID id = getDataID(response);
+    if (id != getDataID(lastRequest))
+    {
+        return;
+    }
+    const OpenThermMessageType type = getMessageType(response);
+    bool supported;
+    if (type == OpenThermMessageType::UNKNOWN_DATA_ID)
+        supported = false;
+    else if (type == OpenThermMessageType::READ_ACK || type == OpenThermMessageType::WRITE_ACK || type == OpenThermMessageType::DATA_INVALID)
+        supported = true;
+    else
+        return;
+
+    if (id == OpenThermMessageID::SConfigSMemberIDcode && type == OpenThermMessageType::READ_ACK)
+    {
+        const long config = response & 0xFFFF;
+        if (slaveConfig >= 0 && config != slaveConfig)
+        {
+            // slave has changed, what was learned may be wrong now
+            clearIdSupport();
+            if (discoveryStarted)
+            {
+                discoveryIndex = 0;
+            }
+        }
+        slaveConfig = config;
+    }
+
+    const bool write = getMessageType(lastRequest) == OpenThermMessageType::WRITE_DATA;
+    bitmapWrite(write ? writeKnown : readKnown, (byte)id, true);
+    bitmapWrite(write ? writeSupported : readSupported, (byte)id, supported);
+}
+#endif
+
+OpenThermResponseStatus OpenTherm::getLastResponseStatus()
+{
+    return responseStatus;
+}
+
+static byte IRAM_ATTR histogramBucket(unsigned long value)
+{
+    byte bucket = 0;
+    while (value > 0 && bucket < OPENTHERM_HISTOGRAM_BUCKETS - 1)
+    {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void IRAM_ATTR OpenTherm::handleInterrupt()
+{
+    if (stats == NULL)
+    {
+        receiveEdge();
+        return;
+    }
+
+    const unsigned long start = openThermMicros();
+    receiveEdge();
+    stats->isrTimeHistogram[histogramBucket(openThermMicros() - start)]++;
+}
+
+void IRAM_ATTR OpenTherm::receiveEdge()
+{
+#if OPENTHERM_EDGE_BUFFER_SIZE > 0
+    if (deferredReceive)
+    {
+        if (isReady() && !isSlave)
+        {
+            return;
+        }
+        const byte head = edgeHead;
+        if ((byte)(head - edgeTail) >= OPENTHERM_EDGE_BUFFER_SIZE)
+        {
+            edgeOverflows = edgeOverflows + 1;
+            return;
+        }
+        // timestamp resolution is reduced to 2us, the lowest bit holds the line state
+        edgeBuffer[head & (OPENTHERM_EDGE_BUFFER_SIZE - 1)] = (openThermMicros() & ~1ul) | (readState() == HIGH ? 1 : 0);
+        edgeHead = head + 1;
+#ifdef INC_FREERTOS_H
+        if (notifyTask != NULL && isSlave && isReady() && head == edgeTail)
+        {
+            // first edge of a request, the task waits without timeout while the slave is ready
+            notifyTaskFromIsr();
+        }
+#endif
+        return;
+    }
+#endif
+
+    if (isReady() && !(isSlave && readState() == HIGH))
+    {
+        return;
+    }
+#ifdef INC_FREERTOS_H
+    const OpenThermStatus previousStatus = status;
+    handleEdge(openThermMicros(), readState());
+    const OpenThermStatus newStatus = status;
+    if (notifyTask != NULL && newStatus != previousStatus &&
+        (newStatus == OpenThermStatus::RESPONSE_READY || newStatus == OpenThermStatus::RESPONSE_INVALID))
+    {
+        // frame is complete, wake the task calling process()
+        notifyTaskFromIsr();
     }
+#else
+    handleEdge(openThermMicros(), readState());
 #endif
-
-    return true;
-}
-
-unsigned long OpenTherm::getLastResponse()
-{
-    return response;
 }
 
-OpenThermResponseStatus OpenTherm::getLastResponseStatus()
+#ifdef INC_FREERTOS_H
+void IRAM_ATTR OpenTherm::notifyTaskFromIsr()
 {
-    return responseStatus;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(notifyTask, &woken);
+    if (woken == pdTRUE)
+    {
+        portYIELD_FROM_ISR();
+    }
 }
+#endif
 
-void IRAM_ATTR OpenTherm::handleInterrupt()
+void IRAM_ATTR OpenTherm::handleEdge(unsigned long newTs, int state)
 {
     if (isReady())
     {
-        if (isSlave && readState() == HIGH)
+        if (isSlave && state == HIGH)
         {
             status = OpenThermStatus::RESPONSE_WAITING;
         }
@@ -229,41 +1116,50 @@ void IRAM_ATTR OpenTherm::handleInterrupt()
         }
     }
 
-    unsigned long newTs = micros();
     if (status == OpenThermStatus::RESPONSE_WAITING)
     {
-        if (readState() == HIGH)
+        if (state == HIGH)
         {
             status = OpenThermStatus::RESPONSE_START_BIT;
+            responseLatency = newTs - responseTimestamp;
             responseTimestamp = newTs;
         }
         else
         {
             status = OpenThermStatus::RESPONSE_INVALID;
             responseTimestamp = newTs;
+            if (stats != NULL)
+            {
+                stats->startBitErrors++;
+            }
         }
     }
     else if (status == OpenThermStatus::RESPONSE_START_BIT)
     {
-        if ((newTs - responseTimestamp < 750) && readState() == LOW)
+        if ((newTs - responseTimestamp < timing.bitThreshold) && state == LOW)
         {
             status = OpenThermStatus::RESPONSE_RECEIVING;
             responseTimestamp = newTs;
             responseBitIndex = 0;
+            response = 0;
         }
         else
         {
             status = OpenThermStatus::RESPONSE_INVALID;
             responseTimestamp = newTs;
+            if (stats != NULL)
+            {
+                stats->startBitErrors++;
+            }
         }
     }
     else if (status == OpenThermStatus::RESPONSE_RECEIVING)
     {
-        if ((newTs - responseTimestamp) > 750)
+        if ((newTs - responseTimestamp) > timing.bitThreshold)
         {
             if (responseBitIndex < 32)
             {
-                response = (response << 1) | !readState();
+                response = (response << 1) | !state;
                 responseTimestamp = newTs;
                 responseBitIndex = responseBitIndex + 1;
             }
@@ -276,6 +1172,49 @@ void IRAM_ATTR OpenTherm::handleInterrupt()
     }
 }
 
+#if OPENTHERM_EDGE_BUFFER_SIZE > 0
+void OpenTherm::setDeferredReceive(bool enable)
+{
+    noInterrupts();
+    deferredReceive = enable;
+    edgeTail = edgeHead;
+    interrupts();
+}
+
+unsigned long OpenTherm::getEdgeOverflows()
+{
+    return edgeOverflows;
+}
+
+void OpenTherm::processEdges()
+{
+    // edges are lost only when the buffer is full, so all buffered edges came before them
+    const unsigned long overflows = edgeOverflows;
+    byte tail = edgeTail;
+    while (tail != edgeHead)
+    {
+        const unsigned long edge = edgeBuffer[tail & (OPENTHERM_EDGE_BUFFER_SIZE - 1)];
+        tail++;
+        edgeTail = tail;
+        noInterrupts();
+        handleEdge(edge & ~1ul, (edge & 1) ? HIGH : LOW);
+        interrupts();
+    }
+
+    if (overflows != processedEdgeOverflows)
+    {
+        // edges were lost, the frame being received can't be trusted
+        processedEdgeOverflows = overflows;
+        noInterrupts();
+        if (status == OpenThermStatus::RESPONSE_START_BIT || status == OpenThermStatus::RESPONSE_RECEIVING)
+        {
+            status = OpenThermStatus::RESPONSE_INVALID;
+        }
+        interrupts();
+    }
+}
+#endif
+
 #if !defined(__AVR__)
 void IRAM_ATTR OpenTherm::handleInterruptHelper(void* ptr)
 {
@@ -283,8 +1222,183 @@ void IRAM_ATTR OpenTherm::handleInterruptHelper(void* ptr)
 }
 #endif
 
+void OpenTherm::setStats(OpenThermStats *stats)
+{
+    if (stats != NULL)
+    {
+        memset(stats, 0, sizeof(OpenThermStats));
+    }
+    noInterrupts();
+    this->stats = stats;
+    interrupts();
+}
+
+bool OpenTherm::getStats(OpenThermStats &snapshot)
+{
+    if (stats == NULL)
+    {
+        return false;
+    }
+
+    // process() side is protected by sequence counter, odd value means update in progress,
+    // interrupt side is copied with interrupts disabled, which takes only a few microseconds.
+    // The copy is repeated a few times at most, a reader which preempted the writer would
+    // otherwise wait for it forever.
+    bool consistent = false;
+    for (byte attempt = 0; attempt < OPENTHERM_SEQUENCE_RETRIES && !consistent; attempt++)
+    {
+        const unsigned long sequence = statsSequence;
+        OPENTHERM_MEMORY_BARRIER();
+        memcpy(&snapshot, stats, sizeof(OpenThermStats));
+        OPENTHERM_MEMORY_BARRIER();
+        consistent = (sequence & 1) == 0 && sequence == statsSequence;
+    }
+    if (!consistent)
+    {
+        return false;
+    }
+
+    noInterrupts();
+    snapshot.startBitErrors = stats->startBitErrors;
+    memcpy(snapshot.isrTimeHistogram, stats->isrTimeHistogram, sizeof(snapshot.isrTimeHistogram));
+    interrupts();
+
+    snapshot.queueDrops = queueDrops;
+    return true;
+}
+
+// odd sequence marks the update in progress, barriers keep the counter ordered with the stats
+void OpenTherm::beginStatsUpdate()
+{
+    statsSequence = statsSequence + 1;
+    OPENTHERM_MEMORY_BARRIER();
+}
+
+void OpenTherm::endStatsUpdate()
+{
+    OPENTHERM_MEMORY_BARRIER();
+    statsSequence = statsSequence + 1;
+}
+
+void OpenTherm::setTrace(OpenThermTrace *trace)
+{
+    this->trace = trace;
+}
+
+void OpenTherm::recordFrameSent(unsigned long frame)
+{
+    const unsigned long now = openThermMicros();
+    if (trace != NULL)
+    {
+        trace->record(OpenThermTraceDirection::SENT, frame, OpenThermResponseStatus::NONE, now);
+    }
+    if (stats == NULL)
+    {
+        return;
+    }
+    beginStatsUpdate();
+    stats->framesSent++;
+    if (!isSlave && conversationEndTimestamp != 0)
+    {
+        stats->frameGapHistogram[histogramBucket((now - conversationEndTimestamp) / 32000)]++;
+    }
+    endStatsUpdate();
+    requestTimestamp = now;
+}
+
+void OpenTherm::recordRetry()
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+    beginStatsUpdate();
+    stats->retries++;
+    endStatsUpdate();
+}
+
+void OpenTherm::recordResult(bool received)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+    const unsigned long now = openThermMicros();
+    beginStatsUpdate();
+    if (received)
+    {
+        stats->framesReceived++;
+    }
+    if (responseStatus == OpenThermResponseStatus::SUCCESS)
+    {
+        stats->success++;
+    }
+    else if (responseStatus == OpenThermResponseStatus::TIMEOUT)
+    {
+        stats->timeout++;
+    }
+    else
+    {
+        stats->invalid++;
+        if (received)
+        {
+            if (parity(response))
+                stats->parityErrors++;
+            else
+                stats->invalidMessageTypes++;
+        }
+    }
+    if (!isSlave)
+    {
+        stats->latencyHistogram[histogramBucket((now - requestTimestamp) / 16000)]++;
+        conversationEndTimestamp = now;
+    }
+    endStatsUpdate();
+}
+
 void OpenTherm::processResponse()
 {
+    // handlers may send the next request, which resets response and its status
+    const unsigned long response = this->response;
+    const OpenThermResponseStatus responseStatus = this->responseStatus;
+    if (trace != NULL)
+    {
+        const unsigned long timestamp = responseStatus == OpenThermResponseStatus::TIMEOUT ? openThermMicros() : responseTimestamp;
+        trace->record(OpenThermTraceDirection::RECEIVED, response, responseStatus, timestamp);
+    }
+    if (!isSlave && responseStatus == OpenThermResponseStatus::SUCCESS && getMessageType(response) == OpenThermMessageType::READ_ACK)
+    {
+        cacheResponse(response);
+    }
+    if (!isSlave && isCommand(lastRequest))
+    {
+        recordWrite(lastRequest, response, responseStatus);
+    }
+#if OPENTHERM_DISCOVERY
+    if (!isSlave)
+    {
+        learnIdSupport(response);
+    }
+#endif
+    const byte attempt = activeAttempt;
+    activeAttempt = 0;
+    if (attempt > 0 && shouldRetry(lastRequest, response, responseStatus, attempt) && retryQueuedRequest(attempt))
+    {
+        // the handler gets the result of the last attempt
+        activeHandler = NULL;
+    }
+    if (activeHandler != NULL)
+    {
+        // cleared before the call so the handler can queue the next request
+        OpenThermResponseHandler handler = activeHandler;
+        activeHandler = NULL;
+        handler(response, responseStatus, activeContext);
+    }
+    for (OpenThermResponseListener *listener = listeners; listener != NULL; listener = listener->next)
+    {
+        listener->handler(response, responseStatus, listener->context);
+    }
+#if OPENTHERM_CALLBACKS
     if (processResponseCallback != NULL)
     {
         processResponseCallback(response, responseStatus);
@@ -295,55 +1409,132 @@ void OpenTherm::processResponse()
         processResponseFunction(response, responseStatus);
     }
 #endif
+#endif
+}
+
+void OpenTherm::setTiming(const OpenThermTiming &timing)
+{
+    noInterrupts();
+    this->timing = timing;
+    interrupts();
+    responseLatencyPeak = 0;
+}
+
+const OpenThermTiming &OpenTherm::getTiming()
+{
+    return timing;
+}
+
+// Response timeout in use. In adaptive mode it is twice the recent peak response time
+// plus a bit margin, but not less than 100ms and not more than the configured timeout.
+unsigned long OpenTherm::getResponseTimeout()
+{
+    if (!timing.adaptiveTimeout || isSlave || responseLatencyPeak == 0)
+    {
+        return timing.responseTimeout;
+    }
+    unsigned long timeout = 2 * responseLatencyPeak + 20000;
+    if (timeout < 100000)
+    {
+        timeout = 100000;
+    }
+    return timeout < timing.responseTimeout ? timeout : timing.responseTimeout;
+}
+
+void OpenTherm::updateResponseLatency(bool received)
+{
+    if (isSlave)
+    {
+        return;
+    }
+    if (received)
+    {
+        // peak follows slower responses immediately and decays by 1/16 per faster one
+        const unsigned long latency = responseLatency;
+        const unsigned long decayed = responseLatencyPeak - (responseLatencyPeak >> 4);
+        responseLatencyPeak = latency > decayed ? latency : decayed;
+    }
+    else if (responseLatencyPeak != 0)
+    {
+        // slave may have become slower, widen the timeout until it answers again
+        responseLatencyPeak = responseLatencyPeak < timing.responseTimeout ? responseLatencyPeak * 2 : responseLatencyPeak;
+    }
 }
 
 void OpenTherm::process()
 {
+#if OPENTHERM_EDGE_BUFFER_SIZE > 0
+    if (deferredReceive)
+    {
+        processEdges();
+    }
+#endif
+
     noInterrupts();
     OpenThermStatus st = status;
     unsigned long ts = responseTimestamp;
     interrupts();
 
     if (st == OpenThermStatus::READY)
+    {
+        sendQueuedRequest();
+#if OPENTHERM_DISCOVERY
+        probeNextId();
+#endif
         return;
-    unsigned long newTs = micros();
-    if (st != OpenThermStatus::NOT_INITIALIZED && st != OpenThermStatus::DELAY && (newTs - ts) > 1000000)
+    }
+    unsigned long newTs = openThermMicros();
+    if (st != OpenThermStatus::NOT_INITIALIZED && st != OpenThermStatus::DELAY && (newTs - ts) > getResponseTimeout())
     {
         status = OpenThermStatus::READY;
         responseStatus = OpenThermResponseStatus::TIMEOUT;
+        updateResponseLatency(false);
+        recordResult(false);
         processResponse();
     }
     else if (st == OpenThermStatus::RESPONSE_INVALID)
     {
         status = OpenThermStatus::DELAY;
         responseStatus = OpenThermResponseStatus::INVALID;
+        recordResult(false);
         processResponse();
     }
     else if (st == OpenThermStatus::RESPONSE_READY)
     {
         status = OpenThermStatus::DELAY;
         responseStatus = (isSlave ? isValidRequest(response) : isValidResponse(response)) ? OpenThermResponseStatus::SUCCESS : OpenThermResponseStatus::INVALID;
+        if (responseStatus == OpenThermResponseStatus::SUCCESS)
+        {
+            updateResponseLatency(true);
+        }
+        recordResult(true);
         processResponse();
     }
     else if (st == OpenThermStatus::DELAY)
     {
-        if ((newTs - ts) > (isSlave ? 20000 : 100000))
+        if ((newTs - ts) > (isSlave ? timing.slaveDelay : timing.masterDelay))
         {
             status = OpenThermStatus::READY;
+            sendQueuedRequest();
+#if OPENTHERM_DISCOVERY
+            probeNextId();
+#endif
         }
     }
 }
 
 bool OpenTherm::parity(unsigned long frame) // odd parity
 {
-    byte p = 0;
-    while (frame > 0)
+#if defined(__GNUC__) && !defined(__AVR__)
+    return __builtin_parityl(frame);
+#else
+    // xor-fold to 4 bits, 0x6996 holds the parity of each 4 bit value
+    for (byte shift = sizeof(frame) * 4; shift >= 4; shift >>= 1)
     {
-        if (frame & 1)
-            p++;
-        frame = frame >> 1;
+        frame ^= frame >> shift;
     }
-    return (p & 1);
+    return (0x6996 >> (frame & 0xF)) & 1;
+#endif
 }
 
 OpenThermMessageType OpenTherm::getMessageType(unsigned long message)
@@ -365,8 +1556,7 @@ unsigned long OpenTherm::buildRequest(OpenThermMessageType type, OpenThermMessag
         request |= 1ul << 28;
     }
     request |= ((unsigned long)id) << 16;
-    if (parity(request))
-        request |= (1ul << 31);
+    request |= (unsigned long)parity(request) << 31;
     return request;
 }
 
@@ -375,25 +1565,35 @@ unsigned long OpenTherm::buildResponse(OpenThermMessageType type, OpenThermMessa
     unsigned long response = data;
     response |= ((unsigned long)type) << 28;
     response |= ((unsigned long)id) << 16;
-    if (parity(response))
-        response |= (1ul << 31);
+    response |= (unsigned long)parity(response) << 31;
     return response;
 }
 
+// READ_ACK and WRITE_ACK are the only message types with bits 30..29 equal to 10
 bool OpenTherm::isValidResponse(unsigned long response)
 {
-    if (parity(response))
-        return false;
-    byte msgType = (response << 1) >> 29;
-    return msgType == (byte)OpenThermMessageType::READ_ACK || msgType == (byte)OpenThermMessageType::WRITE_ACK;
+    return !parity(response) & (((response >> 29) & 3) == 2);
 }
 
+// READ_DATA and WRITE_DATA are the only message types with bits 30..29 equal to 00
 bool OpenTherm::isValidRequest(unsigned long request)
 {
-    if (parity(request))
-        return false;
-    byte msgType = (request << 1) >> 29;
-    return msgType == (byte)OpenThermMessageType::READ_DATA || msgType == (byte)OpenThermMessageType::WRITE_DATA;
+    return !parity(request) & (((request >> 29) & 3) == 0);
+}
+
+unsigned int OpenTherm::validateResponses(const unsigned long *frames, unsigned int count, bool *valid)
+{
+    unsigned int validCount = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const bool isValid = isValidResponse(frames[i]);
+        if (valid != NULL)
+        {
+            valid[i] = isValid;
+        }
+        validCount += isValid;
+    }
+    return validCount;
 }
 
 void OpenTherm::end()
@@ -406,6 +1606,7 @@ OpenTherm::~OpenTherm()
     end();
 }
 
+#if OPENTHERM_STRINGS
 const char *OpenTherm::statusToString(OpenThermResponseStatus status)
 {
     switch (status)
@@ -447,6 +1648,49 @@ const char *OpenTherm::messageTypeToString(OpenThermMessageType message_type)
         return "UNKNOWN";
     }
 }
+#endif
+
+const __FlashStringHelper *OpenTherm::statusToFlashString(OpenThermResponseStatus status)
+{
+    switch (status)
+    {
+    case OpenThermResponseStatus::NONE:
+        return F("NONE");
+    case OpenThermResponseStatus::SUCCESS:
+        return F("SUCCESS");
+    case OpenThermResponseStatus::INVALID:
+        return F("INVALID");
+    case OpenThermResponseStatus::TIMEOUT:
+        return F("TIMEOUT");
+    default:
+        return F("UNKNOWN");
+    }
+}
+
+const __FlashStringHelper *OpenTherm::messageTypeToFlashString(OpenThermMessageType message_type)
+{
+    switch (message_type)
+    {
+    case OpenThermMessageType::READ_DATA:
+        return F("READ_DATA");
+    case OpenThermMessageType::WRITE_DATA:
+        return F("WRITE_DATA");
+    case OpenThermMessageType::INVALID_DATA:
+        return F("INVALID_DATA");
+    case OpenThermMessageType::RESERVED:
+        return F("RESERVED");
+    case OpenThermMessageType::READ_ACK:
+        return F("READ_ACK");
+    case OpenThermMessageType::WRITE_ACK:
+        return F("WRITE_ACK");
+    case OpenThermMessageType::DATA_INVALID:
+        return F("DATA_INVALID");
+    case OpenThermMessageType::UNKNOWN_DATA_ID:
+        return F("UNKNOWN_DATA_ID");
+    default:
+        return F("UNKNOWN");
+    }
+}
 
 // building requests
 
@@ -463,6 +1707,11 @@ unsigned long OpenTherm::buildSetBoilerTemperatureRequest(float temperature)
     return buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TSet, data);
 }
 
+unsigned long OpenTherm::buildSetBoilerTemperatureRequestCenti(int16_t temperature)
+{
+    return buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TSet, temperatureToDataCenti(temperature));
+}
+
 unsigned long OpenTherm::buildGetBoilerTemperatureRequest()
 {
     return buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0);
@@ -507,9 +1756,43 @@ uint16_t OpenTherm::getUInt(const unsigned long response)
 
 float OpenTherm::getFloat(const unsigned long response)
 {
-    const uint16_t u88 = getUInt(response);
-    const float f = (u88 & 0x8000) ? -(0x10000L - u88) / 256.0f : u88 / 256.0f;
-    return f;
+    return (int16_t)getUInt(response) / 256.0f;
+}
+
+int16_t OpenTherm::getF88(const unsigned long response)
+{
+    return (int16_t)getUInt(response);
+}
+
+int16_t OpenTherm::getCenti(const unsigned long response)
+{
+    return f88ToCenti(getF88(response));
+}
+
+// rounded to the nearest hundredth
+int16_t OpenTherm::f88ToCenti(int16_t value)
+{
+    return (int16_t)(((int32_t)value * 100 + 128) >> 8);
+}
+
+// truncated like the float conversion, saturated to the f8.8 range
+int16_t OpenTherm::centiToF88(int16_t value)
+{
+    const int32_t f88 = (int32_t)value * 256 / 100;
+    if (f88 > INT16_MAX)
+        return INT16_MAX;
+    if (f88 < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)f88;
+}
+
+unsigned int OpenTherm::temperatureToDataCenti(int16_t temperature)
+{
+    if (temperature < 0)
+        temperature = 0;
+    if (temperature > 10000)
+        temperature = 10000;
+    return (unsigned int)centiToF88(temperature);
 }
 
 unsigned int OpenTherm::temperatureToData(float temperature)
@@ -526,53 +1809,110 @@ unsigned int OpenTherm::temperatureToData(float temperature)
 
 unsigned long OpenTherm::setBoilerStatus(bool enableCentralHeating, bool enableHotWater, bool enableCooling, bool enableOutsideTemperatureCompensation, bool enableCentralHeating2)
 {
-    return sendRequest(buildSetBoilerStatusRequest(enableCentralHeating, enableHotWater, enableCooling, enableOutsideTemperatureCompensation, enableCentralHeating2));
+    const unsigned long request = buildSetBoilerStatusRequest(enableCentralHeating, enableHotWater, enableCooling, enableOutsideTemperatureCompensation, enableCentralHeating2);
+    unsigned long response;
+    if (getWrittenResponse(request, response))
+    {
+        writesSkipped++;
+        return response;
+    }
+    return sendRequest(request);
+}
+
+bool OpenTherm::writeF88(OpenThermMessageID id, unsigned int data)
+{
+    unsigned long response;
+    return writeData(id, data, response) == OpenThermResponseStatus::SUCCESS;
+}
+
+int16_t OpenTherm::readF88(OpenThermMessageID id, OpenThermResponseStatus *status)
+{
+    unsigned long response;
+    const OpenThermResponseStatus result = readData(id, response);
+    if (status != NULL)
+    {
+        *status = result;
+    }
+    return result == OpenThermResponseStatus::SUCCESS ? getF88(response) : 0;
 }
 
 bool OpenTherm::setBoilerTemperature(float temperature)
 {
-    unsigned long response = sendRequest(buildSetBoilerTemperatureRequest(temperature));
-    return isValidResponse(response);
+    return writeF88(OpenThermMessageID::TSet, temperatureToData(temperature));
+}
+
+bool OpenTherm::setBoilerTemperatureCenti(int16_t temperature)
+{
+    return writeF88(OpenThermMessageID::TSet, temperatureToDataCenti(temperature));
+}
+
+float OpenTherm::getBoilerTemperature(OpenThermResponseStatus *status)
+{
+    return readF88(OpenThermMessageID::Tboiler, status) / 256.0f;
+}
+
+int16_t OpenTherm::getBoilerTemperatureCenti(OpenThermResponseStatus *status)
+{
+    return f88ToCenti(readF88(OpenThermMessageID::Tboiler, status));
 }
 
-float OpenTherm::getBoilerTemperature()
+float OpenTherm::getReturnTemperature(OpenThermResponseStatus *status)
 {
-    unsigned long response = sendRequest(buildGetBoilerTemperatureRequest());
-    return isValidResponse(response) ? getFloat(response) : 0;
+    return readF88(OpenThermMessageID::Tret, status) / 256.0f;
 }
 
-float OpenTherm::getReturnTemperature()
+int16_t OpenTherm::getReturnTemperatureCenti(OpenThermResponseStatus *status)
 {
-    unsigned long response = sendRequest(buildRequest(OpenThermRequestType::READ, OpenThermMessageID::Tret, 0));
-    return isValidResponse(response) ? getFloat(response) : 0;
+    return f88ToCenti(readF88(OpenThermMessageID::Tret, status));
 }
 
 bool OpenTherm::setDHWSetpoint(float temperature)
 {
-    unsigned int data = temperatureToData(temperature);
-    unsigned long response = sendRequest(buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TdhwSet, data));
-    return isValidResponse(response);
+    return writeF88(OpenThermMessageID::TdhwSet, temperatureToData(temperature));
+}
+
+bool OpenTherm::setDHWSetpointCenti(int16_t temperature)
+{
+    return writeF88(OpenThermMessageID::TdhwSet, temperatureToDataCenti(temperature));
+}
+
+float OpenTherm::getDHWTemperature(OpenThermResponseStatus *status)
+{
+    return readF88(OpenThermMessageID::Tdhw, status) / 256.0f;
 }
 
-float OpenTherm::getDHWTemperature()
+int16_t OpenTherm::getDHWTemperatureCenti(OpenThermResponseStatus *status)
 {
-    unsigned long response = sendRequest(buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tdhw, 0));
-    return isValidResponse(response) ? getFloat(response) : 0;
+    return f88ToCenti(readF88(OpenThermMessageID::Tdhw, status));
 }
 
-float OpenTherm::getModulation()
+float OpenTherm::getModulation(OpenThermResponseStatus *status)
 {
-    unsigned long response = sendRequest(buildRequest(OpenThermRequestType::READ, OpenThermMessageID::RelModLevel, 0));
-    return isValidResponse(response) ? getFloat(response) : 0;
+    return readF88(OpenThermMessageID::RelModLevel, status) / 256.0f;
 }
 
-float OpenTherm::getPressure()
+int16_t OpenTherm::getModulationCenti(OpenThermResponseStatus *status)
 {
-    unsigned long response = sendRequest(buildRequest(OpenThermRequestType::READ, OpenThermMessageID::CHPressure, 0));
-    return isValidResponse(response) ? getFloat(response) : 0;
+    return f88ToCenti(readF88(OpenThermMessageID::RelModLevel, status));
 }
 
-unsigned char OpenTherm::getFault()
+float OpenTherm::getPressure(OpenThermResponseStatus *status)
 {
-    return ((sendRequest(buildRequest(OpenThermRequestType::READ, OpenThermMessageID::ASFflags, 0)) >> 8) & 0xff);
+    return readF88(OpenThermMessageID::CHPressure, status) / 256.0f;
+}
+
+int16_t OpenTherm::getPressureCenti(OpenThermResponseStatus *status)
+{
+    return f88ToCenti(readF88(OpenThermMessageID::CHPressure, status));
+}
+
+unsigned char OpenTherm::getFault(OpenThermResponseStatus *status)
+{
+    unsigned long response;
+    const OpenThermResponseStatus result = readData(OpenThermMessageID::ASFflags, response);
+    if (status != NULL)
+    {
+        *status = result;
+    }
+    return result == OpenThermResponseStatus::SUCCESS ? ((response >> 8) & 0xff) : 0;
 }
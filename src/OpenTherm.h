@@ -14,7 +14,8 @@ P MGS-TYPE SPARE DATA-ID  DATA-VALUE
 #define OpenTherm_h
 
 #include <stdint.h>
-#include <Arduino.h>
+#include "OpenThermConfig.h"
+#include "OpenThermHal.h"
 
 enum class OpenThermResponseStatus : byte
 {
@@ -147,6 +148,86 @@ enum class OpenThermMessageID : byte
     SlaveVersion                               = 127, // u8/u8     Slave product version number and type
 };
 
+typedef void (*OpenThermResponseHandler)(unsigned long response, OpenThermResponseStatus status, void *context);
+
+// Histogram bucket 0 counts values below its unit, bucket N counts values in [unit * 2^(N-1), unit * 2^N),
+// the last bucket also counts everything above.
+struct OpenThermStats
+{
+    unsigned long framesSent;
+    unsigned long framesReceived;
+    unsigned long success;
+    unsigned long invalid;
+    unsigned long timeout;
+    unsigned long parityErrors;
+    unsigned long invalidMessageTypes;
+    unsigned long queueDrops;
+    unsigned long retries;
+    unsigned long latencyHistogram[OPENTHERM_HISTOGRAM_BUCKETS];  // request start to response, 16ms unit
+    unsigned long frameGapHistogram[OPENTHERM_HISTOGRAM_BUCKETS]; // end of conversation to next request, 32ms unit
+
+    // updated from interrupt handler
+    unsigned long startBitErrors;
+    unsigned long isrTimeHistogram[OPENTHERM_HISTOGRAM_BUCKETS]; // 1us unit
+};
+
+enum class OpenThermIdSupport : byte
+{
+    UNKNOWN,
+    SUPPORTED,
+    UNSUPPORTED
+};
+
+struct OpenThermTiming
+{
+    unsigned long responseTimeout; // us without edges before response is given up, slave must answer within 800ms
+    unsigned long masterDelay;     // us between end of response and next request, spec minimum is 100ms
+    unsigned long slaveDelay;      // us between end of request and response
+    unsigned int bitThreshold;     // us after a bit edge before next bit edge is expected, 3/4 of bit time
+    bool adaptiveTimeout;          // shorten response timeout to the measured slave response time
+
+    OpenThermTiming() :
+        responseTimeout(1000000),
+        masterDelay(100000),
+        slaveDelay(20000),
+        bitThreshold(750),
+        adaptiveTimeout(false)
+    {
+    }
+};
+
+// Requests which timed out or got a corrupted response are sent again, a valid DATA_INVALID or
+// UNKNOWN_DATA_ID answer is final. RemoteRequest commands are never repeated.
+struct OpenThermRetryPolicy
+{
+    byte maxAttempts;          // including the first one, 1 disables retries
+    unsigned long backoff;     // ms before the second attempt, doubled for each next one
+    unsigned long maxBackoff;  // ms, upper bound of the backoff
+    bool retryWrites;          // WRITE_DATA of a value is idempotent, disable for slaves which count writes
+
+    OpenThermRetryPolicy(byte maxAttempts = 1, unsigned long backoff = 100, unsigned long maxBackoff = 1000, bool retryWrites = true) :
+        maxAttempts(maxAttempts),
+        backoff(backoff),
+        maxBackoff(maxBackoff),
+        retryWrites(retryWrites)
+    {
+    }
+};
+
+class OpenThermTrace;
+class OpenThermFuture;
+
+#if OPENTHERM_COROUTINES
+class OpenThermAwaitable;
+#endif
+
+struct OpenThermResponseListener
+{
+    OpenThermResponseHandler handler;
+    void *context;
+    OpenThermResponseListener *next;
+};
+
 enum class OpenThermStatus : byte
 {
     NOT_INITIALIZED,
@@ -157,7 +238,9 @@ enum class OpenThermStatus : byte
     RESPONSE_START_BIT,
     RESPONSE_RECEIVING,
     RESPONSE_READY,
-    RESPONSE_INVALID
+    RESPONSE_INVALID,
+    REQUEST_SENDING_FIRST_HALF,  // timer-driven transmission, first half of the current bit
+    REQUEST_SENDING_SECOND_HALF  // timer-driven transmission, second half of the current bit
 };
 
 class OpenTherm
@@ -167,25 +250,84 @@ public:
     ~OpenTherm();
     volatile OpenThermStatus status;
     void begin(void (*handleInterruptCallback)(void));
+#if OPENTHERM_CALLBACKS
     void begin(void (*handleInterruptCallback)(void), void (*processResponseCallback)(unsigned long, OpenThermResponseStatus));
+#endif
 #if !defined(__AVR__)
     void begin();
+#if OPENTHERM_CALLBACKS
     void begin(std::function<void(unsigned long, OpenThermResponseStatus)> processResponseFunction);
 #endif
+#endif
+    void setTransmitTimer(void (*startTimerCallback)(void), void (*stopTimerCallback)(void));
     bool isReady();
     unsigned long sendRequest(unsigned long request);
+#if OPENTHERM_SLAVE
     bool sendResponse(unsigned long request);
+#endif
     bool sendRequestAsync(unsigned long request);
     [[deprecated("Use OpenTherm::sendRequestAsync(unsigned long) instead")]]
     bool sendRequestAync(unsigned long request) {
         return sendRequestAsync(request);
     }
+    void addResponseListener(OpenThermResponseListener *listener);
+    void removeResponseListener(OpenThermResponseListener *listener);
+    bool enqueueRequest(unsigned long request, OpenThermResponseHandler handler = NULL, void *context = NULL);
+    bool sendRequestAsync(unsigned long request, OpenThermFuture &future);
+    // queues a write replacing a queued write of the same ID, Status is sent as READ_DATA with master flags
+    bool enqueueWrite(OpenThermMessageID id, unsigned int data, OpenThermResponseHandler handler = NULL, void *context = NULL);
+#if OPENTHERM_COROUTINES
+    OpenThermAwaitable read(OpenThermMessageID id);
+    OpenThermAwaitable write(OpenThermMessageID id, unsigned int data);
+#endif
+    byte getQueueDepth();
+    byte getMaxQueueDepth();
+    unsigned long getQueueDrops();
     static unsigned long buildRequest(OpenThermMessageType type, OpenThermMessageID id, unsigned int data);
     static unsigned long buildResponse(OpenThermMessageType type, OpenThermMessageID id, unsigned int data);
     unsigned long getLastResponse();
+    void setStats(OpenThermStats *stats);
+    void setTrace(OpenThermTrace *trace);
+    // false without stats, or when they were updated during every copy attempt, try again later
+    bool getStats(OpenThermStats &snapshot);
+    unsigned long getLastFrameTimestamp();
+    void setTiming(const OpenThermTiming &timing);
+    const OpenThermTiming &getTiming();
+    unsigned long getResponseTimeout();
+    void setRetryPolicy(const OpenThermRetryPolicy &policy);
+    bool setRetryPolicy(OpenThermMessageID id, const OpenThermRetryPolicy &policy);
+    void clearRetryPolicy(OpenThermMessageID id);
+    const OpenThermRetryPolicy &getRetryPolicy(OpenThermMessageID id);
+    void setCacheMaxAge(unsigned long maxAge);
+    bool getCachedResponse(OpenThermMessageID id, unsigned long &response, unsigned long maxAge);
+    // false for Status and indexed IDs, whose answer depends on the data of the request
+    static bool isCacheable(OpenThermMessageID id);
+    void clearCache();
+    void setWriteRefresh(unsigned long refresh);
+    unsigned long getWritesSkipped();
+    void clearWriteCache();
+    bool isIdSupported(OpenThermMessageID id, OpenThermMessageType type = OpenThermMessageType::READ_DATA);
+#if OPENTHERM_DISCOVERY
+    OpenThermIdSupport getIdSupport(OpenThermMessageID id, OpenThermMessageType type);
+    void clearIdSupport();
+    void startDiscovery();
+    bool isDiscovering();
+#endif
     OpenThermResponseStatus getLastResponseStatus();
+    // blocking read and write with cache, ID support and retries applied, returns the final status
+    OpenThermResponseStatus readData(OpenThermMessageID id, unsigned long &response);
+    OpenThermResponseStatus writeData(OpenThermMessageID id, unsigned int data, unsigned long &response);
+#if OPENTHERM_STRINGS
     static const char *statusToString(OpenThermResponseStatus status);
+#endif
+    static const __FlashStringHelper *statusToFlashString(OpenThermResponseStatus status);
     void handleInterrupt();
+    void handleTimerInterrupt();
+    void handleEdge(unsigned long timestamp, int state);
+#if OPENTHERM_EDGE_BUFFER_SIZE > 0
+    void setDeferredReceive(bool enable);
+    unsigned long getEdgeOverflows();
+#endif
 #if !defined(__AVR__)
     static void handleInterruptHelper(void* ptr);
 #endif
@@ -195,13 +337,19 @@ public:
     static bool parity(unsigned long frame);
     static OpenThermMessageType getMessageType(unsigned long message);
     static OpenThermMessageID getDataID(unsigned long frame);
+#if OPENTHERM_STRINGS
     static const char *messageTypeToString(OpenThermMessageType message_type);
+#endif
+    static const __FlashStringHelper *messageTypeToFlashString(OpenThermMessageType message_type);
     static bool isValidRequest(unsigned long request);
     static bool isValidResponse(unsigned long response);
+    // returns number of valid responses, validity of each frame is stored in valid if not NULL
+    static unsigned int validateResponses(const unsigned long *frames, unsigned int count, bool *valid = NULL);
 
     // requests
     static unsigned long buildSetBoilerStatusRequest(bool enableCentralHeating, bool enableHotWater = false, bool enableCooling = false, bool enableOutsideTemperatureCompensation = false, bool enableCentralHeating2 = false);
     static unsigned long buildSetBoilerTemperatureRequest(float temperature);
+    static unsigned long buildSetBoilerTemperatureRequestCenti(int16_t temperature);
     static unsigned long buildGetBoilerTemperatureRequest();
 
     // responses
@@ -215,38 +363,188 @@ public:
     static float getFloat(const unsigned long response);
     static unsigned int temperatureToData(float temperature);
 
-    // basic requests
+    // fixed point, f8.8 is raw data in 1/256 units, centi values are in 1/100 units
+    static int16_t getF88(const unsigned long response);
+    static int16_t getCenti(const unsigned long response);
+    static int16_t f88ToCenti(int16_t value);
+    static int16_t centiToF88(int16_t value);
+    static unsigned int temperatureToDataCenti(int16_t temperature);
+
+    // basic requests, getters store the final status in status if not NULL, value is 0 unless it is SUCCESS
     unsigned long setBoilerStatus(bool enableCentralHeating, bool enableHotWater = false, bool enableCooling = false, bool enableOutsideTemperatureCompensation = false, bool enableCentralHeating2 = false);
     bool setBoilerTemperature(float temperature);
-    float getBoilerTemperature();
-    float getReturnTemperature();
+    float getBoilerTemperature(OpenThermResponseStatus *status = NULL);
+    float getReturnTemperature(OpenThermResponseStatus *status = NULL);
     bool setDHWSetpoint(float temperature);
-    float getDHWTemperature();
-    float getModulation();
-    float getPressure();
-    unsigned char getFault();
+    float getDHWTemperature(OpenThermResponseStatus *status = NULL);
+    float getModulation(OpenThermResponseStatus *status = NULL);
+    float getPressure(OpenThermResponseStatus *status = NULL);
+    bool setBoilerTemperatureCenti(int16_t temperature);
+    int16_t getBoilerTemperatureCenti(OpenThermResponseStatus *status = NULL);
+    int16_t getReturnTemperatureCenti(OpenThermResponseStatus *status = NULL);
+    bool setDHWSetpointCenti(int16_t temperature);
+    int16_t getDHWTemperatureCenti(OpenThermResponseStatus *status = NULL);
+    int16_t getModulationCenti(OpenThermResponseStatus *status = NULL);
+    int16_t getPressureCenti(OpenThermResponseStatus *status = NULL);
+    unsigned char getFault(OpenThermResponseStatus *status = NULL);
 
 private:
+    friend class OpenThermBus;
+    friend class OpenThermTask;
+
     const int inPin;
     const int outPin;
+#if OPENTHERM_SLAVE
     const bool isSlave;
+#else
+    static const bool isSlave = false;
+#endif
+    OpenThermPin inPinIo;
+    OpenThermPin outPinIo;
 
     volatile unsigned long response;
     volatile OpenThermResponseStatus responseStatus;
     volatile unsigned long responseTimestamp;
     volatile byte responseBitIndex;
 
+    OpenThermTiming timing;
+    volatile unsigned long responseLatency; // end of request to start bit of response
+    unsigned long responseLatencyPeak;
+    void updateResponseLatency(bool received);
+
     int readState();
     void setActiveState();
     void setIdleState();
     void activateBoiler();
+    void attach(void (*handleInterruptCallback)(void));
+
+    void (*startTimerCallback)(void);
+    void (*stopTimerCallback)(void);
+    bool sharedTimer;
+    volatile unsigned long txFrame;
+    volatile byte txBitIndex;
+
+#if OPENTHERM_EDGE_BUFFER_SIZE > 0
+    static_assert((OPENTHERM_EDGE_BUFFER_SIZE & (OPENTHERM_EDGE_BUFFER_SIZE - 1)) == 0 && OPENTHERM_EDGE_BUFFER_SIZE <= 128,
+        "OPENTHERM_EDGE_BUFFER_SIZE must be a power of two not greater than 128");
+    bool deferredReceive;
+    volatile unsigned long edgeBuffer[OPENTHERM_EDGE_BUFFER_SIZE];
+    volatile byte edgeHead;
+    volatile byte edgeTail;
+    volatile unsigned long edgeOverflows;
+    unsigned long processedEdgeOverflows;
+
+    void processEdges();
+#endif
+
+    struct QueuedRequest
+    {
+        unsigned long request;
+        OpenThermResponseHandler handler;
+        void *context;
+        byte attempt;
+        unsigned long notBefore; // ms, retried requests wait for their backoff
+        bool coalesce;           // added by enqueueWrite, replaced by a newer value of the same data ID
+    };
+    QueuedRequest queue[OPENTHERM_REQUEST_QUEUE_SIZE];
+    byte queueHead;
+    byte queueCount;
+    byte queueMaxCount;
+    unsigned long queueDrops;
+    bool queuePaused;
+    OpenThermResponseHandler activeHandler;
+    void *activeContext;
+    byte activeAttempt; // 0 unless the request in progress is from the queue
+    OpenThermResponseListener *listeners;
+
+    bool enqueue(unsigned long request, OpenThermResponseHandler handler, void *context, bool coalesce);
+    void sendQueuedRequest();
+    unsigned long getQueueDelay();
+
+    struct RetryOverride
+    {
+        OpenThermMessageID id;
+        bool used;
+        OpenThermRetryPolicy policy;
+    };
+    OpenThermRetryPolicy retryPolicy;
+    RetryOverride retryOverrides[OPENTHERM_RETRY_OVERRIDES];
+
+    bool shouldRetry(unsigned long request, unsigned long response, OpenThermResponseStatus status, byte attempt);
+    unsigned long getRetryDelay(unsigned long request, byte attempt);
+    bool retryQueuedRequest(byte attempt);
+
+    struct CachedResponse
+    {
+        unsigned long response;
+        unsigned long timestamp;
+    };
+    CachedResponse cache[OPENTHERM_CACHE_SIZE];
+    unsigned long cacheMaxAge;
+
+    void cacheResponse(unsigned long response);
+
+    // last acknowledged command of a data ID, 0 response marks an empty entry
+    struct WrittenCommand
+    {
+        unsigned long request;
+        unsigned long response;
+        unsigned long timestamp;
+    };
+    WrittenCommand writeCache[OPENTHERM_WRITE_CACHE_SIZE];
+    unsigned long writeRefresh;
+    unsigned long writesSkipped;
+
+    static bool isCommand(unsigned long request);
+    void recordWrite(unsigned long request, unsigned long response, OpenThermResponseStatus status);
+    bool getWrittenResponse(unsigned long request, unsigned long &response);
+
+    unsigned long lastRequest;
+#if OPENTHERM_DISCOVERY
+    // bit per data ID, known bit is set once the slave has answered the request type
+    byte readKnown[32];
+    byte readSupported[32];
+    byte writeKnown[32];
+    byte writeSupported[32];
+    int discoveryIndex;     // next codec descriptor to probe, -1 when not discovering
+    bool discoveryStarted;
+    long slaveConfig;       // last SConfigSMemberIDcode data, -1 when not received
+
+    void learnIdSupport(unsigned long response);
+    void probeNextId();
+#endif
+    unsigned long readData(OpenThermMessageID id);
+    int16_t readF88(OpenThermMessageID id, OpenThermResponseStatus *status);
+    bool writeF88(OpenThermMessageID id, unsigned int data);
+
+    OpenThermStats *stats;
+    volatile unsigned long statsSequence;
+    unsigned long requestTimestamp;
+    unsigned long conversationEndTimestamp;
+
+    void receiveEdge();
+    OpenThermTrace *trace;
+#ifdef INC_FREERTOS_H
+    TaskHandle_t notifyTask;
+    void notifyTaskFromIsr();
+#endif
+
+    void recordFrameSent(unsigned long frame);
+    void recordResult(bool received);
+    void recordRetry();
+    void beginStatsUpdate();
+    void endStatsUpdate();
 
     void sendBit(bool high);
+    bool sendFrame(unsigned long frame);
+    void sendHalfBit(bool firstHalf);
     void processResponse();
+#if OPENTHERM_CALLBACKS
     void (*processResponseCallback)(unsigned long, OpenThermResponseStatus);
 #if !defined(__AVR__)
     std::function<void(unsigned long, OpenThermResponseStatus)> processResponseFunction;
 #endif
+#endif
 };
 
 #ifndef ICACHE_RAM_ATTR
@@ -0,0 +1,155 @@
+/*
+OpenThermBus.cpp - Several OpenTherm buses driven by one controller
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermBus.h"
+
+OpenThermBus::OpenThermBus(OpenTherm **buses, byte count) :
+    buses(buses),
+    count(count < OPENTHERM_BUS_SIZE ? count : OPENTHERM_BUS_SIZE),
+    inputLevels(0),
+    first(0),
+    stopTimerCallback(NULL),
+    sampleTimestamp(0),
+    windowStart(0)
+{
+    for (byte i = 0; i < OPENTHERM_BUS_SIZE; i++)
+    {
+        busyTime[i] = 0;
+        utilization[i] = 0;
+    }
+}
+
+void OpenThermBus::begin(void (*handleInterruptCallback)(void))
+{
+    // all buses are activated by one delay instead of one per bus
+    for (byte i = 0; i < count; i++)
+    {
+        buses[i]->attach(handleInterruptCallback);
+        buses[i]->setIdleState();
+    }
+    delay(1000);
+    for (byte i = 0; i < count; i++)
+    {
+        buses[i]->status = OpenThermStatus::READY;
+    }
+    noInterrupts();
+    inputLevels = 0;
+    for (byte i = 0; i < count; i++)
+    {
+        if (buses[i]->readState() == HIGH)
+        {
+            inputLevels |= 1 << i;
+        }
+    }
+    interrupts();
+    sampleTimestamp = windowStart = openThermMicros();
+}
+
+// Start function may be called while the timer is already running and must not restart it,
+// otherwise bit timing of buses being transmitted is broken.
+void OpenThermBus::setTransmitTimer(void (*startTimerCallback)(void), void (*stopTimerCallback)(void))
+{
+    this->stopTimerCallback = stopTimerCallback;
+    for (byte i = 0; i < count; i++)
+    {
+        buses[i]->sharedTimer = true;
+        buses[i]->setTransmitTimer(startTimerCallback, NULL);
+    }
+}
+
+// Pin change interrupts don't tell which pin has changed, so input levels are compared
+// with the levels seen by the previous call.
+void IRAM_ATTR OpenThermBus::handleInterrupt()
+{
+    for (byte i = 0; i < count; i++)
+    {
+        const byte mask = 1 << i;
+        const byte level = buses[i]->readState() == HIGH ? mask : 0;
+        if ((inputLevels & mask) != level)
+        {
+            inputLevels ^= mask;
+            buses[i]->handleInterrupt();
+        }
+    }
+}
+
+void IRAM_ATTR OpenThermBus::handleTimerInterrupt()
+{
+    bool sending = false;
+    for (byte i = 0; i < count; i++)
+    {
+        buses[i]->handleTimerInterrupt();
+        sending = sending || isSending(*buses[i]);
+    }
+    if (!sending && stopTimerCallback != NULL)
+    {
+        stopTimerCallback();
+    }
+}
+
+bool IRAM_ATTR OpenThermBus::isSending(OpenTherm &ot)
+{
+    const OpenThermStatus st = ot.status;
+    return st == OpenThermStatus::REQUEST_SENDING_FIRST_HALF || st == OpenThermStatus::REQUEST_SENDING_SECOND_HALF;
+}
+
+void OpenThermBus::process()
+{
+    for (byte n = 0; n < count; n++)
+    {
+        byte i = first + n;
+        if (i >= count)
+        {
+            i -= count;
+        }
+        buses[i]->process();
+    }
+    first = first + 1 < count ? first + 1 : 0;
+    updateUtilization();
+}
+
+// Bus is busy from the start of request until the end of the delay after response,
+// so 100% means it can't take more requests.
+void OpenThermBus::updateUtilization()
+{
+    const unsigned long now = openThermMicros();
+    const unsigned long elapsed = now - sampleTimestamp;
+    sampleTimestamp = now;
+    for (byte i = 0; i < count; i++)
+    {
+        const OpenThermStatus st = buses[i]->status;
+        if (st != OpenThermStatus::READY && st != OpenThermStatus::NOT_INITIALIZED)
+        {
+            busyTime[i] += elapsed;
+        }
+    }
+
+    const unsigned long window = now - windowStart;
+    if (window >= 1000000)
+    {
+        for (byte i = 0; i < count; i++)
+        {
+            const unsigned long busy = busyTime[i] < window ? busyTime[i] : window;
+            utilization[i] = busy / (window / 100);
+            busyTime[i] = 0;
+        }
+        windowStart = now;
+    }
+}
+
+byte OpenThermBus::getCount()
+{
+    return count;
+}
+
+OpenTherm &OpenThermBus::get(byte index)
+{
+    return *buses[index];
+}
+
+byte OpenThermBus::getUtilization(byte index)
+{
+    return index < count ? utilization[index] : 0;
+}
@@ -0,0 +1,46 @@
+/*
+OpenThermBus.h - Several OpenTherm buses driven by one controller
+Copyright 2023, Ihor Melnyk
+
+Input pins of all buses share one interrupt handler, frames of all buses are
+clocked out by one 500us timer, so conversations on different buses overlap
+instead of blocking each other.
+*/
+
+#ifndef OpenThermBus_h
+#define OpenThermBus_h
+
+#include "OpenTherm.h"
+
+class OpenThermBus
+{
+public:
+    OpenThermBus(OpenTherm **buses, byte count);
+    void begin(void (*handleInterruptCallback)(void));
+    void setTransmitTimer(void (*startTimerCallback)(void), void (*stopTimerCallback)(void));
+    void handleInterrupt();
+    void handleTimerInterrupt();
+    void process();
+    byte getCount();
+    OpenTherm &get(byte index);
+    byte getUtilization(byte index); // percent of time bus was busy in the last second
+
+private:
+    static_assert(OPENTHERM_BUS_SIZE <= 8, "OPENTHERM_BUS_SIZE must not be greater than 8");
+
+    OpenTherm **buses;
+    const byte count;
+    byte inputLevels;      // last input level of each bus, bit per bus
+    byte first;            // bus processed first, rotated to share process() time fairly
+    void (*stopTimerCallback)(void);
+
+    unsigned long sampleTimestamp;
+    unsigned long windowStart;
+    unsigned long busyTime[OPENTHERM_BUS_SIZE];
+    byte utilization[OPENTHERM_BUS_SIZE];
+
+    static bool isSending(OpenTherm &ot);
+    void updateUtilization();
+};
+
+#endif // OpenThermBus_h
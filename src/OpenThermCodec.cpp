@@ -0,0 +1,69 @@
+/*
+OpenThermCodec.cpp - Data formats of OpenTherm data IDs
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermCodec.h"
+
+#if OPENTHERM_STRINGS
+// names are in program memory on AVR, like the table which points to them
+#define OPENTHERM_DATA_NAME(ID, FORMAT, ACCESS) \
+    static const char name##ID[] PROGMEM = #ID;
+OPENTHERM_DATA_IDS(OPENTHERM_DATA_NAME)
+#undef OPENTHERM_DATA_NAME
+
+#define OPENTHERM_DATA_DESCRIPTOR(ID, FORMAT, ACCESS) \
+    {OpenThermMessageID::ID, OpenThermDataFormat::FORMAT, OpenThermDataAccess::ACCESS, name##ID},
+#else
+#define OPENTHERM_DATA_DESCRIPTOR(ID, FORMAT, ACCESS) \
+    {OpenThermMessageID::ID, OpenThermDataFormat::FORMAT, OpenThermDataAccess::ACCESS},
+#endif
+
+// sorted by data ID, in program memory on AVR
+static const OpenThermDataDescriptor descriptors[] PROGMEM = {
+    OPENTHERM_DATA_IDS(OPENTHERM_DATA_DESCRIPTOR)
+};
+
+#undef OPENTHERM_DATA_DESCRIPTOR
+
+static const byte DESCRIPTOR_COUNT = sizeof(descriptors) / sizeof(descriptors[0]);
+
+bool OpenThermCodec::describe(OpenThermMessageID id, OpenThermDataDescriptor &descriptor)
+{
+    byte low = 0;
+    byte high = DESCRIPTOR_COUNT;
+    while (low < high)
+    {
+        const byte middle = (low + high) / 2;
+        if (pgm_read_byte(&descriptors[middle].id) < (byte)id)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low < DESCRIPTOR_COUNT && pgm_read_byte(&descriptors[low].id) == (byte)id)
+    {
+        descriptor = getDescriptor(low);
+        return true;
+    }
+    return false;
+}
+
+#if OPENTHERM_STRINGS
+const __FlashStringHelper *OpenThermCodec::idToFlashString(OpenThermMessageID id)
+{
+    OpenThermDataDescriptor descriptor;
+    return describe(id, descriptor) ? reinterpret_cast<const __FlashStringHelper *>(descriptor.name) : F("UNKNOWN");
+}
+#endif
+
+byte OpenThermCodec::getDescriptorCount()
+{
+    return DESCRIPTOR_COUNT;
+}
+
+OpenThermDataDescriptor OpenThermCodec::getDescriptor(byte index)
+{
+    OpenThermDataDescriptor descriptor;
+    memcpy_P(&descriptor, &descriptors[index], sizeof(OpenThermDataDescriptor));
+    return descriptor;
+}
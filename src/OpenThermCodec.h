@@ -0,0 +1,326 @@
+/*
+OpenThermCodec.h - Data formats of OpenTherm data IDs
+Copyright 2023, Ihor Melnyk
+
+Each data ID is described by format, access and name. Typed values are decoded
+and encoded at compile time:
+    OpenThermDayTime dayTime = OpenThermCodec::decode<OpenThermMessageID::DayTime>(response);
+    int16_t raw = OpenThermCodec::decode<OpenThermMessageID::Tboiler>(response).raw;
+*/
+
+#ifndef OpenThermCodec_h
+#define OpenThermCodec_h
+
+#include "OpenTherm.h"
+
+enum class OpenThermDataFormat : byte
+{
+    F8_8,        // signed fixed point, 1/256
+    U8_U8,
+    S8_S8,
+    U16,
+    S16,
+    FLAG8_FLAG8,
+    FLAG8_U8,
+    FLAG8_NONE,  // flag8/-
+    U8_NONE,     // u8/-
+    NONE_U8,     // -/u8
+    DAY_TIME,    // special/u8
+    SPECIAL
+};
+
+enum class OpenThermDataAccess : byte
+{
+    NONE = 0,
+    READ = 1,
+    WRITE = 2,
+    READ_WRITE = 3
+};
+
+// X(id, format, access)
+#define OPENTHERM_DATA_IDS(X)                                          \
+    X(Status, FLAG8_FLAG8, READ)                                       \
+    X(TSet, F8_8, WRITE)                                               \
+    X(MConfigMMemberIDcode, FLAG8_U8, WRITE)                           \
+    X(SConfigSMemberIDcode, FLAG8_U8, READ)                            \
+    X(RemoteRequest, U8_U8, WRITE)                                     \
+    X(ASFflags, FLAG8_U8, READ)                                        \
+    X(RBPflags, FLAG8_FLAG8, READ)                                     \
+    X(CoolingControl, F8_8, WRITE)                                     \
+    X(TsetCH2, F8_8, WRITE)                                            \
+    X(TrOverride, F8_8, READ)                                          \
+    X(TSP, U8_U8, READ)                                                \
+    X(TSPindexTSPvalue, U8_U8, READ_WRITE)                             \
+    X(FHBsize, U8_U8, READ)                                            \
+    X(FHBindexFHBvalue, U8_U8, READ)                                   \
+    X(MaxRelModLevelSetting, F8_8, WRITE)                              \
+    X(MaxCapacityMinModLevel, U8_U8, READ)                             \
+    X(TrSet, F8_8, WRITE)                                              \
+    X(RelModLevel, F8_8, READ)                                         \
+    X(CHPressure, F8_8, READ)                                          \
+    X(DHWFlowRate, F8_8, READ)                                         \
+    X(DayTime, DAY_TIME, READ_WRITE)                                   \
+    X(Date, U8_U8, READ_WRITE)                                         \
+    X(Year, U16, READ_WRITE)                                           \
+    X(TrSetCH2, F8_8, WRITE)                                           \
+    X(Tr, F8_8, WRITE)                                                 \
+    X(Tboiler, F8_8, READ)                                             \
+    X(Tdhw, F8_8, READ)                                                \
+    X(Toutside, F8_8, READ)                                            \
+    X(Tret, F8_8, READ)                                                \
+    X(Tstorage, F8_8, READ)                                            \
+    X(Tcollector, F8_8, READ)                                          \
+    X(TflowCH2, F8_8, READ)                                            \
+    X(Tdhw2, F8_8, READ)                                               \
+    X(Texhaust, S16, READ)                                             \
+    X(TboilerHeatExchanger, F8_8, READ)                                \
+    X(BoilerFanSpeedSetpointAndActual, U8_U8, READ)                    \
+    X(FlameCurrent, F8_8, READ)                                        \
+    X(TrCH2, F8_8, WRITE)                                              \
+    X(RelativeHumidity, F8_8, READ_WRITE)                              \
+    X(TrOverride2, F8_8, READ)                                         \
+    X(TdhwSetUBTdhwSetLB, S8_S8, READ)                                 \
+    X(MaxTSetUBMaxTSetLB, S8_S8, READ)                                 \
+    X(TdhwSet, F8_8, READ_WRITE)                                       \
+    X(MaxTSet, F8_8, READ_WRITE)                                       \
+    X(StatusVentilationHeatRecovery, FLAG8_FLAG8, READ)                \
+    X(Vset, NONE_U8, WRITE)                                            \
+    X(ASFflagsOEMfaultCodeVentilationHeatRecovery, FLAG8_U8, READ)     \
+    X(OEMDiagnosticCodeVentilationHeatRecovery, U16, READ)             \
+    X(SConfigSMemberIDCodeVentilationHeatRecovery, FLAG8_U8, READ)     \
+    X(OpenThermVersionVentilationHeatRecovery, F8_8, READ)             \
+    X(VentilationHeatRecoveryVersion, U8_U8, READ)                     \
+    X(RelVentLevel, NONE_U8, READ)                                     \
+    X(RHexhaust, NONE_U8, READ)                                        \
+    X(CO2exhaust, U16, READ)                                           \
+    X(Tsi, F8_8, READ)                                                 \
+    X(Tso, F8_8, READ)                                                 \
+    X(Tei, F8_8, READ)                                                 \
+    X(Teo, F8_8, READ)                                                 \
+    X(RPMexhaust, U16, READ)                                           \
+    X(RPMsupply, U16, READ)                                            \
+    X(RBPflagsVentilationHeatRecovery, FLAG8_FLAG8, READ)              \
+    X(NominalVentilationValue, U8_NONE, READ_WRITE)                    \
+    X(TSPventilationHeatRecovery, U8_U8, READ)                         \
+    X(TSPindexTSPvalueVentilationHeatRecovery, U8_U8, READ_WRITE)      \
+    X(FHBsizeVentilationHeatRecovery, U8_U8, READ)                     \
+    X(FHBindexFHBvalueVentilationHeatRecovery, U8_U8, READ)            \
+    X(Brand, U8_U8, READ)                                              \
+    X(BrandVersion, U8_U8, READ)                                       \
+    X(BrandSerialNumber, U8_U8, READ)                                  \
+    X(CoolingOperationHours, U16, READ_WRITE)                          \
+    X(PowerCycles, U16, READ_WRITE)                                    \
+    X(RFsensorStatusInformation, SPECIAL, WRITE)                       \
+    X(RemoteOverrideOperatingModeHeatingDHW, SPECIAL, READ)            \
+    X(RemoteOverrideFunction, FLAG8_NONE, READ)                        \
+    X(StatusSolarStorage, FLAG8_FLAG8, READ)                           \
+    X(ASFflagsOEMfaultCodeSolarStorage, FLAG8_U8, READ)                \
+    X(SConfigSMemberIDcodeSolarStorage, FLAG8_U8, READ)                \
+    X(SolarStorageVersion, U8_U8, READ)                                \
+    X(TSPSolarStorage, U8_U8, READ)                                    \
+    X(TSPindexTSPvalueSolarStorage, U8_U8, READ_WRITE)                 \
+    X(FHBsizeSolarStorage, U8_U8, READ)                                \
+    X(FHBindexFHBvalueSolarStorage, U8_U8, READ)                       \
+    X(ElectricityProducerStarts, U16, READ_WRITE)                      \
+    X(ElectricityProducerHours, U16, READ_WRITE)                       \
+    X(ElectricityProduction, U16, READ)                                \
+    X(CumulativElectricityProduction, U16, READ_WRITE)                 \
+    X(UnsuccessfulBurnerStarts, U16, READ_WRITE)                       \
+    X(FlameSignalTooLowNumber, U16, READ_WRITE)                        \
+    X(OEMDiagnosticCode, U16, READ)                                    \
+    X(SuccessfulBurnerStarts, U16, READ_WRITE)                         \
+    X(CHPumpStarts, U16, READ_WRITE)                                   \
+    X(DHWPumpValveStarts, U16, READ_WRITE)                             \
+    X(DHWBurnerStarts, U16, READ_WRITE)                                \
+    X(BurnerOperationHours, U16, READ_WRITE)                           \
+    X(CHPumpOperationHours, U16, READ_WRITE)                           \
+    X(DHWPumpValveOperationHours, U16, READ_WRITE)                     \
+    X(DHWBurnerOperationHours, U16, READ_WRITE)                        \
+    X(OpenThermVersionMaster, F8_8, WRITE)                             \
+    X(OpenThermVersionSlave, F8_8, READ)                               \
+    X(MasterVersion, U8_U8, WRITE)                                     \
+    X(SlaveVersion, U8_U8, READ)
+
+struct OpenThermF88
+{
+    int16_t raw; // 1/256 units
+    constexpr float toFloat() const
+    {
+        return raw / 256.0f;
+    }
+};
+
+struct OpenThermU8U8
+{
+    uint8_t hb;
+    uint8_t lb;
+};
+
+struct OpenThermS8S8
+{
+    int8_t hb;
+    int8_t lb;
+};
+
+struct OpenThermDayTime
+{
+    uint8_t dayOfWeek; // 1 - Monday .. 7 - Sunday, 0 - not used
+    uint8_t hours;
+    uint8_t minutes;
+};
+
+template <OpenThermDataFormat format>
+struct OpenThermFormatTraits;
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::F8_8>
+{
+    typedef OpenThermF88 type;
+    static constexpr type decode(uint16_t data) { return type{(int16_t)data}; }
+    static constexpr uint16_t encode(type value) { return (uint16_t)value.raw; }
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::U8_U8>
+{
+    typedef OpenThermU8U8 type;
+    static constexpr type decode(uint16_t data) { return type{(uint8_t)(data >> 8), (uint8_t)data}; }
+    static constexpr uint16_t encode(type value) { return ((uint16_t)value.hb << 8) | value.lb; }
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::S8_S8>
+{
+    typedef OpenThermS8S8 type;
+    static constexpr type decode(uint16_t data) { return type{(int8_t)(data >> 8), (int8_t)data}; }
+    static constexpr uint16_t encode(type value) { return ((uint16_t)(uint8_t)value.hb << 8) | (uint8_t)value.lb; }
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::U16>
+{
+    typedef uint16_t type;
+    static constexpr type decode(uint16_t data) { return data; }
+    static constexpr uint16_t encode(type value) { return value; }
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::S16>
+{
+    typedef int16_t type;
+    static constexpr type decode(uint16_t data) { return (int16_t)data; }
+    static constexpr uint16_t encode(type value) { return (uint16_t)value; }
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::FLAG8_FLAG8> : OpenThermFormatTraits<OpenThermDataFormat::U8_U8>
+{
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::FLAG8_U8> : OpenThermFormatTraits<OpenThermDataFormat::U8_U8>
+{
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::FLAG8_NONE>
+{
+    typedef uint8_t type;
+    static constexpr type decode(uint16_t data) { return data >> 8; }
+    static constexpr uint16_t encode(type value) { return (uint16_t)value << 8; }
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::U8_NONE> : OpenThermFormatTraits<OpenThermDataFormat::FLAG8_NONE>
+{
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::NONE_U8>
+{
+    typedef uint8_t type;
+    static constexpr type decode(uint16_t data) { return (uint8_t)data; }
+    static constexpr uint16_t encode(type value) { return value; }
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::DAY_TIME>
+{
+    typedef OpenThermDayTime type;
+    static constexpr type decode(uint16_t data) { return type{(uint8_t)(data >> 13), (uint8_t)((data >> 8) & 0x1F), (uint8_t)data}; }
+    static constexpr uint16_t encode(type value) { return ((uint16_t)(value.dayOfWeek & 0x07) << 13) | ((uint16_t)(value.hours & 0x1F) << 8) | value.minutes; }
+};
+
+template <>
+struct OpenThermFormatTraits<OpenThermDataFormat::SPECIAL> : OpenThermFormatTraits<OpenThermDataFormat::U16>
+{
+};
+
+template <OpenThermMessageID id>
+struct OpenThermDataTraits;
+
+#define OPENTHERM_DATA_TRAITS(ID, FORMAT, ACCESS)                                      \
+    template <>                                                                        \
+    struct OpenThermDataTraits<OpenThermMessageID::ID>                                 \
+    {                                                                                  \
+        static constexpr OpenThermDataFormat format = OpenThermDataFormat::FORMAT;     \
+        static constexpr OpenThermDataAccess access = OpenThermDataAccess::ACCESS;     \
+    };
+OPENTHERM_DATA_IDS(OPENTHERM_DATA_TRAITS)
+#undef OPENTHERM_DATA_TRAITS
+
+struct OpenThermDataDescriptor
+{
+    OpenThermMessageID id;
+    OpenThermDataFormat format;
+    OpenThermDataAccess access;
+#if OPENTHERM_STRINGS
+    const char *name; // in program memory on AVR, see OpenThermCodec::idToFlashString
+#endif
+};
+
+class OpenThermCodec
+{
+public:
+    template <OpenThermMessageID id>
+    using Value = typename OpenThermFormatTraits<OpenThermDataTraits<id>::format>::type;
+
+    template <OpenThermMessageID id>
+    static constexpr Value<id> decode(unsigned long frame)
+    {
+        return OpenThermFormatTraits<OpenThermDataTraits<id>::format>::decode((uint16_t)(frame & 0xFFFF));
+    }
+
+    template <OpenThermMessageID id>
+    static constexpr uint16_t encode(Value<id> value)
+    {
+        return OpenThermFormatTraits<OpenThermDataTraits<id>::format>::encode(value);
+    }
+
+    template <OpenThermMessageID id>
+    static unsigned long buildReadRequest()
+    {
+        static_assert(((byte)OpenThermDataTraits<id>::access & (byte)OpenThermDataAccess::READ) != 0, "data ID is not readable");
+        return OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, id, 0);
+    }
+
+    template <OpenThermMessageID id>
+    static unsigned long buildWriteRequest(Value<id> value)
+    {
+        static_assert(((byte)OpenThermDataTraits<id>::access & (byte)OpenThermDataAccess::WRITE) != 0, "data ID is not writable");
+        return OpenTherm::buildRequest(OpenThermMessageType::WRITE_DATA, id, encode<id>(value));
+    }
+
+    // runtime lookup, returns false for IDs not defined in OpenThermMessageID.
+    // The table is in program memory on AVR, descriptors are copied out.
+    static bool describe(OpenThermMessageID id, OpenThermDataDescriptor &descriptor);
+#if OPENTHERM_STRINGS
+    // name of the data ID, e.g. Serial.println(OpenThermCodec::idToFlashString(id))
+    static const __FlashStringHelper *idToFlashString(OpenThermMessageID id);
+#endif
+    // descriptors in data ID order
+    static byte getDescriptorCount();
+    static OpenThermDataDescriptor getDescriptor(byte index);
+};
+
+#endif // OpenThermCodec_h
@@ -0,0 +1,165 @@
+/*
+OpenThermConfig.h - Compile-time configuration of OpenTherm Library
+Copyright 2023, Ihor Melnyk
+
+Every option can be overridden with a compiler flag, e.g.
+build_flags = -DOPENTHERM_SLAVE=0 in PlatformIO or
+--build-property "compiler.cpp.extra_flags=-DOPENTHERM_SLAVE=0" with arduino-cli.
+Flags must be set for the whole build, defining them in a sketch before
+including the library doesn't change how the library itself is compiled.
+tools/size_report.sh shows RAM and flash usage of typical configurations.
+*/
+
+#ifndef OpenThermConfig_h
+#define OpenThermConfig_h
+
+// Features
+
+// Slave role: OpenTherm(inPin, outPin, true), sendResponse, OpenThermSlave and OpenThermGateway.
+// Define as 0 on master-only nodes.
+#ifndef OPENTHERM_SLAVE
+#define OPENTHERM_SLAVE 1
+#endif
+
+// Response callbacks passed to begin(), function pointer and std::function on ESP8266/ESP32.
+// Define as 0 when responses are taken from the blocking helpers, handlers or listeners.
+#ifndef OPENTHERM_CALLBACKS
+#define OPENTHERM_CALLBACKS 1
+#endif
+
+// statusToString and messageTypeToString, which return strings kept in RAM on AVR, and data ID names of
+// OpenThermCodec, which are kept in program memory. statusToFlashString and messageTypeToFlashString
+// keep their strings in program memory and are available regardless.
+#ifndef OPENTHERM_STRINGS
+#define OPENTHERM_STRINGS 1
+#endif
+
+// Supported data ID bitmaps, 128 bytes per instance
+#ifndef OPENTHERM_DISCOVERY
+#if defined(__AVR__)
+#define OPENTHERM_DISCOVERY 0
+#else
+#define OPENTHERM_DISCOVERY 1
+#endif
+#endif
+
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<coroutine>)
+#define OPENTHERM_COROUTINES 1
+#endif
+#endif
+#ifndef OPENTHERM_COROUTINES
+#define OPENTHERM_COROUTINES 0
+#endif
+
+// Sizes
+
+// Size of the edge buffer used by deferred receive, must be a power of two not greater than 128.
+// Define as 0 to compile deferred receive out.
+#ifndef OPENTHERM_EDGE_BUFFER_SIZE
+#if defined(__AVR__)
+#define OPENTHERM_EDGE_BUFFER_SIZE 0
+#else
+#define OPENTHERM_EDGE_BUFFER_SIZE 128
+#endif
+#endif
+
+// Number of requests which can be queued with OpenTherm::enqueueRequest
+#ifndef OPENTHERM_REQUEST_QUEUE_SIZE
+#if defined(__AVR__)
+#define OPENTHERM_REQUEST_QUEUE_SIZE 4
+#else
+#define OPENTHERM_REQUEST_QUEUE_SIZE 8
+#endif
+#endif
+
+// Number of data IDs whose last valid response is cached
+#ifndef OPENTHERM_CACHE_SIZE
+#if defined(__AVR__)
+#define OPENTHERM_CACHE_SIZE 4
+#else
+#define OPENTHERM_CACHE_SIZE 16
+#endif
+#endif
+
+// Number of data IDs with their own retry policy
+#ifndef OPENTHERM_RETRY_OVERRIDES
+#if defined(__AVR__)
+#define OPENTHERM_RETRY_OVERRIDES 2
+#else
+#define OPENTHERM_RETRY_OVERRIDES 4
+#endif
+#endif
+
+// Number of data IDs whose last acknowledged write is remembered to drop identical writes
+#ifndef OPENTHERM_WRITE_CACHE_SIZE
+#if defined(__AVR__)
+#define OPENTHERM_WRITE_CACHE_SIZE 4
+#else
+#define OPENTHERM_WRITE_CACHE_SIZE 8
+#endif
+#endif
+
+#ifndef OPENTHERM_HISTOGRAM_BUCKETS
+#define OPENTHERM_HISTOGRAM_BUCKETS 8
+#endif
+
+// Number of buses handled by one OpenThermBus
+#ifndef OPENTHERM_BUS_SIZE
+#define OPENTHERM_BUS_SIZE 4
+#endif
+
+// Number of requests waiting for OpenThermTask
+#ifndef OPENTHERM_TASK_QUEUE_SIZE
+#define OPENTHERM_TASK_QUEUE_SIZE 8
+#endif
+
+// Size of command lines read by OpenThermOtgwParser
+#ifndef OPENTHERM_OTGW_LINE_SIZE
+#define OPENTHERM_OTGW_LINE_SIZE 16
+#endif
+
+// Bytes written per flush by OpenThermOtgwWriter and OpenThermTrace to streams which don't report
+// their free space, availableForWrite() returning 0, writing them may block until they are sent
+#ifndef OPENTHERM_FLUSH_CHUNK
+#define OPENTHERM_FLUSH_CHUNK 16
+#endif
+
+// Number of OpenThermGateway rules
+#ifndef OPENTHERM_GATEWAY_RULES
+#define OPENTHERM_GATEWAY_RULES 8
+#endif
+
+// Number of OpenThermSubscriptions handlers
+#ifndef OPENTHERM_SUBSCRIPTIONS
+#if defined(__AVR__)
+#define OPENTHERM_SUBSCRIPTIONS 4
+#else
+#define OPENTHERM_SUBSCRIPTIONS 16
+#endif
+#endif
+
+// Number of attempts to copy data protected by a sequence counter, e.g. OpenTherm::getStats,
+// before the reader gives up because the writer keeps updating it
+#ifndef OPENTHERM_SEQUENCE_RETRIES
+#define OPENTHERM_SEQUENCE_RETRIES 4
+#endif
+
+// Timing
+
+// Status must be exchanged at least every second, its period is limited to leave room for one conversation
+#ifndef OPENTHERM_STATUS_MAX_PERIOD
+#define OPENTHERM_STATUS_MAX_PERIOD 800
+#endif
+
+// delay before a failed OpenThermTableReader request is repeated, ms
+#ifndef OPENTHERM_TABLE_RETRY_DELAY
+#define OPENTHERM_TABLE_RETRY_DELAY 1000
+#endif
+
+// failed requests of one OpenThermTableReader entry before it is skipped
+#ifndef OPENTHERM_TABLE_RETRIES
+#define OPENTHERM_TABLE_RETRIES 3
+#endif
+
+#endif // OpenThermConfig_h
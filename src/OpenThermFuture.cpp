@@ -0,0 +1,70 @@
+/*
+OpenThermFuture.cpp - Result of asynchronous OpenTherm request
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermFuture.h"
+
+OpenThermFuture::OpenThermFuture() :
+    pending(false),
+    handler(NULL),
+    context(NULL)
+{
+    result.response = 0;
+    result.status = OpenThermResponseStatus::NONE;
+}
+
+void OpenThermFuture::then(OpenThermResponseHandler handler, void *context)
+{
+    this->handler = handler;
+    this->context = context;
+}
+
+bool OpenThermFuture::isPending()
+{
+    return pending;
+}
+
+bool OpenThermFuture::isDone()
+{
+    return !pending && result.status != OpenThermResponseStatus::NONE;
+}
+
+OpenThermResult OpenThermFuture::getResult()
+{
+    return result;
+}
+
+unsigned long OpenThermFuture::getResponse()
+{
+    return result.response;
+}
+
+OpenThermResponseStatus OpenThermFuture::getStatus()
+{
+    return result.status;
+}
+
+void OpenThermFuture::start()
+{
+    result.response = 0;
+    result.status = OpenThermResponseStatus::NONE;
+    pending = true;
+}
+
+void OpenThermFuture::complete(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    OpenThermFuture *future = static_cast<OpenThermFuture *>(context);
+    if (!future->pending)
+    {
+        return;
+    }
+    future->result.response = response;
+    future->result.status = status;
+    future->pending = false;
+    if (future->handler != NULL)
+    {
+        // future may be reused or destroyed by the handler
+        future->handler(response, status, future->context);
+    }
+}
@@ -0,0 +1,108 @@
+/*
+OpenThermFuture.h - Result of asynchronous OpenTherm request
+Copyright 2023, Ihor Melnyk
+
+Future is owned by the caller and must stay alive until the request is done,
+no dynamic memory is used. With C++20 requests can be awaited in coroutines:
+    OpenThermResult result = co_await ot.read(OpenThermMessageID::Tboiler);
+*/
+
+#ifndef OpenThermFuture_h
+#define OpenThermFuture_h
+
+#include "OpenTherm.h"
+
+#if OPENTHERM_COROUTINES
+#include <coroutine>
+#endif
+
+struct OpenThermResult
+{
+    unsigned long response;
+    OpenThermResponseStatus status;
+
+    bool isSuccess() const
+    {
+        return status == OpenThermResponseStatus::SUCCESS;
+    }
+    float getFloat() const
+    {
+        return OpenTherm::getFloat(response);
+    }
+    uint16_t getUInt() const
+    {
+        return OpenTherm::getUInt(response);
+    }
+};
+
+class OpenThermFuture
+{
+public:
+    OpenThermFuture();
+    // handler is called once from OpenTherm::process() when the request is done
+    void then(OpenThermResponseHandler handler, void *context = NULL);
+    bool isPending();
+    bool isDone();
+    OpenThermResult getResult();
+    unsigned long getResponse();
+    OpenThermResponseStatus getStatus();
+
+private:
+    friend class OpenTherm;
+
+    volatile bool pending;
+    OpenThermResult result;
+    OpenThermResponseHandler handler;
+    void *context;
+
+    void start();
+    static void complete(unsigned long response, OpenThermResponseStatus status, void *context);
+};
+
+#if OPENTHERM_COROUTINES
+// Coroutine is resumed from OpenTherm::process() when the response is received.
+class OpenThermAwaitable
+{
+public:
+    OpenThermAwaitable(OpenTherm &ot, unsigned long request) :
+        ot(ot),
+        request(request)
+    {
+    }
+
+    bool await_ready()
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        // not suspended if the request can't be sent, result status is NONE then
+        if (!ot.sendRequestAsync(request, future) || !future.isPending())
+        {
+            return false;
+        }
+        this->handle = handle;
+        future.then(resume, this);
+        return true;
+    }
+
+    OpenThermResult await_resume()
+    {
+        return future.getResult();
+    }
+
+private:
+    OpenTherm &ot;
+    const unsigned long request;
+    OpenThermFuture future;
+    std::coroutine_handle<> handle;
+
+    static void resume(unsigned long, OpenThermResponseStatus, void *context)
+    {
+        static_cast<OpenThermAwaitable *>(context)->handle.resume();
+    }
+};
+#endif
+
+#endif // OpenThermFuture_h
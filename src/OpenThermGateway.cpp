@@ -0,0 +1,302 @@
+/*
+OpenThermGateway.cpp - OpenTherm Gateway between thermostat and boiler
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermGateway.h"
+
+#if OPENTHERM_SLAVE
+
+// truncated like OpenTherm::centiToF88, saturated to the f8.8 range
+static int16_t floatToF88(float value)
+{
+    const float f88 = value * 256;
+    if (f88 >= INT16_MAX)
+        return INT16_MAX;
+    if (f88 <= INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)f88;
+}
+
+OpenThermGateway::OpenThermGateway(int masterInPin, int masterOutPin, int slaveInPin, int slaveOutPin) :
+    master(masterInPin, masterOutPin),
+    slave(slaveInPin, slaveOutPin, true),
+    frameHandler(NULL),
+    frameHandlerContext(NULL),
+    cacheMaxAge(0),
+    lastRequest(0),
+    requestWaiting(false),
+    pendingResponse(0),
+    forwardedCount(0),
+    cachedCount(0),
+    overriddenCount(0)
+{
+    for (byte i = 0; i < OPENTHERM_GATEWAY_RULES; i++)
+    {
+        rules[i].type = OpenThermGatewayRuleType::NONE;
+    }
+    slaveListener.handler = handleSlaveFrame;
+    slaveListener.context = this;
+    slaveListener.next = NULL;
+}
+
+void OpenThermGateway::begin(void (*masterInterruptCallback)(void), void (*slaveInterruptCallback)(void))
+{
+    master.begin(masterInterruptCallback);
+    slave.begin(slaveInterruptCallback);
+    init();
+}
+
+#if !defined(__AVR__)
+void OpenThermGateway::begin()
+{
+    master.begin();
+    slave.begin();
+    init();
+}
+#endif
+
+void OpenThermGateway::init()
+{
+    slave.removeResponseListener(&slaveListener);
+    slave.addResponseListener(&slaveListener);
+}
+
+void OpenThermGateway::process()
+{
+    master.process();
+    slave.process();
+    // slave must wait at least 20ms after request, so the answer is sent once slave is ready
+    if (pendingResponse != 0 && slave.isReady())
+    {
+        const unsigned long response = pendingResponse;
+        pendingResponse = 0;
+        if (slave.sendResponse(response))
+        {
+            notify(OpenThermGatewayFrame::THERMOSTAT_RESPONSE, response);
+        }
+    }
+}
+
+void OpenThermGateway::setFrameHandler(OpenThermGatewayFrameHandler handler, void *context)
+{
+    frameHandler = handler;
+    frameHandlerContext = context;
+}
+
+void OpenThermGateway::setCacheMaxAge(unsigned long maxAge)
+{
+    cacheMaxAge = maxAge;
+}
+
+bool OpenThermGateway::overrideValue(OpenThermMessageID id, unsigned int data)
+{
+    Rule *rule = addRule(id);
+    if (rule == NULL)
+    {
+        return false;
+    }
+    rule->type = OpenThermGatewayRuleType::OVERRIDE;
+    rule->min = (int16_t)data;
+    rule->max = (int16_t)data;
+    return true;
+}
+
+bool OpenThermGateway::overrideWrite(OpenThermMessageID id, unsigned int data)
+{
+    Rule *rule = addRule(id);
+    if (rule == NULL)
+    {
+        return false;
+    }
+    rule->type = OpenThermGatewayRuleType::WRITE_OVERRIDE;
+    rule->min = (int16_t)data;
+    rule->max = (int16_t)data;
+    return true;
+}
+
+bool OpenThermGateway::clampValue(OpenThermMessageID id, float min, float max)
+{
+    Rule *rule = addRule(id);
+    if (rule == NULL)
+    {
+        return false;
+    }
+    rule->type = OpenThermGatewayRuleType::CLAMP;
+    rule->min = floatToF88(min);
+    rule->max = floatToF88(max);
+    return true;
+}
+
+bool OpenThermGateway::clampValueCenti(OpenThermMessageID id, int16_t min, int16_t max)
+{
+    Rule *rule = addRule(id);
+    if (rule == NULL)
+    {
+        return false;
+    }
+    rule->type = OpenThermGatewayRuleType::CLAMP;
+    rule->min = OpenTherm::centiToF88(min);
+    rule->max = OpenTherm::centiToF88(max);
+    return true;
+}
+
+void OpenThermGateway::clearRule(OpenThermMessageID id)
+{
+    Rule *rule = findRule(id);
+    if (rule != NULL)
+    {
+        rule->type = OpenThermGatewayRuleType::NONE;
+    }
+}
+
+unsigned long OpenThermGateway::getForwardedCount()
+{
+    return forwardedCount;
+}
+
+unsigned long OpenThermGateway::getCachedCount()
+{
+    return cachedCount;
+}
+
+unsigned long OpenThermGateway::getOverriddenCount()
+{
+    return overriddenCount;
+}
+
+OpenThermGateway::Rule *OpenThermGateway::findRule(OpenThermMessageID id)
+{
+    for (byte i = 0; i < OPENTHERM_GATEWAY_RULES; i++)
+    {
+        if (rules[i].type != OpenThermGatewayRuleType::NONE && rules[i].id == id)
+        {
+            return &rules[i];
+        }
+    }
+    return NULL;
+}
+
+OpenThermGateway::Rule *OpenThermGateway::addRule(OpenThermMessageID id)
+{
+    Rule *rule = findRule(id);
+    for (byte i = 0; rule == NULL && i < OPENTHERM_GATEWAY_RULES; i++)
+    {
+        if (rules[i].type == OpenThermGatewayRuleType::NONE)
+        {
+            rule = &rules[i];
+        }
+    }
+    if (rule != NULL)
+    {
+        rule->id = id;
+    }
+    return rule;
+}
+
+void OpenThermGateway::notify(OpenThermGatewayFrame type, unsigned long frame)
+{
+    if (frameHandler != NULL)
+    {
+        frameHandler(type, frame, frameHandlerContext);
+    }
+}
+
+void OpenThermGateway::handleRequest(unsigned long request)
+{
+    notify(OpenThermGatewayFrame::THERMOSTAT_REQUEST, request);
+
+    const OpenThermMessageType type = OpenTherm::getMessageType(request);
+    const OpenThermMessageID id = OpenTherm::getDataID(request);
+    uint16_t data = OpenTherm::getUInt(request);
+    lastRequest = request;
+    requestWaiting = true;
+    pendingResponse = 0;
+
+    Rule *rule = findRule(id);
+    if (rule != NULL && rule->type == OpenThermGatewayRuleType::OVERRIDE && type == OpenThermMessageType::READ_DATA)
+    {
+        overriddenCount++;
+        pendingResponse = OpenTherm::buildResponse(OpenThermMessageType::READ_ACK, id, (uint16_t)rule->min);
+        return;
+    }
+
+    // only plain reads can be answered from cache, Status and indexed reads carry data in request,
+    // also when it is 0, e.g. Status with CH and DHW off must reach the boiler
+    unsigned long response;
+    if (cacheMaxAge > 0 && type == OpenThermMessageType::READ_DATA && data == 0 && OpenTherm::isCacheable(id) &&
+        master.getCachedResponse(id, response, cacheMaxAge))
+    {
+        cachedCount++;
+        pendingResponse = response;
+        return;
+    }
+
+    if (rule != NULL && rule->type == OpenThermGatewayRuleType::CLAMP && type == OpenThermMessageType::WRITE_DATA)
+    {
+        const int16_t value = (int16_t)data;
+        if (value < rule->min || value > rule->max)
+        {
+            overriddenCount++;
+            data = (uint16_t)(value < rule->min ? rule->min : rule->max);
+            request = OpenTherm::buildRequest(type, id, data);
+        }
+    }
+    else if (rule != NULL && rule->type == OpenThermGatewayRuleType::WRITE_OVERRIDE && type == OpenThermMessageType::WRITE_DATA)
+    {
+        if (data != (uint16_t)rule->min)
+        {
+            overriddenCount++;
+            data = (uint16_t)rule->min;
+            request = OpenTherm::buildRequest(type, id, data);
+        }
+    }
+
+    if (master.enqueueRequest(request, handleMasterResponse, this))
+    {
+        forwardedCount++;
+        notify(OpenThermGatewayFrame::BOILER_REQUEST, request);
+    }
+}
+
+void OpenThermGateway::handleResponse(unsigned long response)
+{
+    notify(OpenThermGatewayFrame::BOILER_RESPONSE, response);
+
+    const OpenThermMessageID id = OpenTherm::getDataID(response);
+    if (!requestWaiting || OpenTherm::getDataID(lastRequest) != id)
+    {
+        // thermostat has already sent another request
+        return;
+    }
+
+    // acknowledge the value thermostat has written, not the clamped one
+    if (OpenTherm::getMessageType(response) == OpenThermMessageType::WRITE_ACK &&
+        OpenTherm::getUInt(response) != OpenTherm::getUInt(lastRequest))
+    {
+        response = OpenTherm::buildResponse(OpenThermMessageType::WRITE_ACK, id, OpenTherm::getUInt(lastRequest));
+    }
+    requestWaiting = false;
+    pendingResponse = response;
+}
+
+void OpenThermGateway::handleSlaveFrame(unsigned long frame, OpenThermResponseStatus status, void *context)
+{
+    if (status == OpenThermResponseStatus::SUCCESS)
+    {
+        static_cast<OpenThermGateway *>(context)->handleRequest(frame);
+    }
+}
+
+void OpenThermGateway::handleMasterResponse(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    // DATA_INVALID and UNKNOWN_DATA_ID are passed through, corrupted or missing
+    // boiler response is not answered and thermostat will repeat the request
+    if (status != OpenThermResponseStatus::TIMEOUT && response != 0 && !OpenTherm::parity(response) &&
+        (byte)OpenTherm::getMessageType(response) >= (byte)OpenThermMessageType::READ_ACK)
+    {
+        static_cast<OpenThermGateway *>(context)->handleResponse(response);
+    }
+}
+
+#endif // OPENTHERM_SLAVE
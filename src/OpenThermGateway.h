@@ -0,0 +1,93 @@
+/*
+OpenThermGateway.h - OpenTherm Gateway between thermostat and boiler
+Copyright 2023, Ihor Melnyk
+
+Thermostat is connected to the slave side and boiler to the master side.
+Requests are forwarded asynchronously through the master request queue,
+reads can be answered from the response cache and per data ID rules can
+override or clamp values.
+*/
+
+#ifndef OpenThermGateway_h
+#define OpenThermGateway_h
+
+#include "OpenTherm.h"
+
+#if OPENTHERM_SLAVE
+
+enum class OpenThermGatewayFrame : byte
+{
+    THERMOSTAT_REQUEST, // received from thermostat
+    BOILER_REQUEST,     // sent to boiler
+    BOILER_RESPONSE,    // received from boiler
+    THERMOSTAT_RESPONSE // sent to thermostat
+};
+
+enum class OpenThermGatewayRuleType : byte
+{
+    NONE,
+    OVERRIDE,       // answer reads locally with fixed value
+    CLAMP,          // limit f8.8 value of writes
+    WRITE_OVERRIDE  // replace value of writes before they are forwarded
+};
+
+typedef void (*OpenThermGatewayFrameHandler)(OpenThermGatewayFrame type, unsigned long frame, void *context);
+
+class OpenThermGateway
+{
+public:
+    OpenThermGateway(int masterInPin, int masterOutPin, int slaveInPin, int slaveOutPin);
+    OpenTherm master; // boiler side
+    OpenTherm slave;  // thermostat side
+
+    void begin(void (*masterInterruptCallback)(void), void (*slaveInterruptCallback)(void));
+#if !defined(__AVR__)
+    void begin();
+#endif
+    void process();
+    void setFrameHandler(OpenThermGatewayFrameHandler handler, void *context = NULL);
+    void setCacheMaxAge(unsigned long maxAge);
+    bool overrideValue(OpenThermMessageID id, unsigned int data);
+    // e.g. setpoints, which thermostat sends as WRITE_DATA
+    bool overrideWrite(OpenThermMessageID id, unsigned int data);
+    bool clampValue(OpenThermMessageID id, float min, float max);
+    bool clampValueCenti(OpenThermMessageID id, int16_t min, int16_t max);
+    void clearRule(OpenThermMessageID id);
+
+    unsigned long getForwardedCount();
+    unsigned long getCachedCount();
+    unsigned long getOverriddenCount();
+
+private:
+    struct Rule
+    {
+        OpenThermMessageID id;
+        OpenThermGatewayRuleType type;
+        int16_t min;
+        int16_t max;
+    };
+    Rule rules[OPENTHERM_GATEWAY_RULES];
+    OpenThermResponseListener slaveListener;
+    OpenThermGatewayFrameHandler frameHandler;
+    void *frameHandlerContext;
+    unsigned long cacheMaxAge;
+    unsigned long lastRequest;
+    bool requestWaiting; // lastRequest waits for the boiler, Status with all flags clear is frame 0
+    unsigned long pendingResponse;
+    unsigned long forwardedCount;
+    unsigned long cachedCount;
+    unsigned long overriddenCount;
+
+    void init();
+    Rule *findRule(OpenThermMessageID id);
+    Rule *addRule(OpenThermMessageID id);
+    void notify(OpenThermGatewayFrame type, unsigned long frame);
+    void handleRequest(unsigned long request);
+    void handleResponse(unsigned long response);
+    static void handleSlaveFrame(unsigned long frame, OpenThermResponseStatus status, void *context);
+    static void handleMasterResponse(unsigned long response, OpenThermResponseStatus status, void *context);
+};
+
+#endif // OPENTHERM_SLAVE
+
+#endif // OpenThermGateway_h
@@ -0,0 +1,163 @@
+/*
+OpenThermHal.h - Pin and clock backends of OpenTherm Library
+Copyright 2023, Ihor Melnyk
+
+OpenThermPin is selected at compile time:
+- default: Arduino digitalRead/digitalWrite
+- OPENTHERM_FAST_IO: direct register access on AVR, ESP8266 and ESP32
+- OPENTHERM_HOST: simulated pins and virtual clock for Linux builds
+- OPENTHERM_PIN_CLASS: user provided class with begin(int), read() and write(int)
+*/
+
+#ifndef OpenThermHal_h
+#define OpenThermHal_h
+
+#include <stdint.h>
+
+#if defined(OPENTHERM_HOST)
+#include "OpenThermHost.h"
+#else
+#include <Arduino.h>
+#endif
+
+#if defined(OPENTHERM_FAST_IO) && defined(ARDUINO_ARCH_ESP32)
+#include "hal/gpio_ll.h"
+#endif
+
+// Orders memory accesses around sequence counters, e.g. OpenTherm::getStats.
+// AVR has a single core, keeping the compiler from reordering is enough there.
+#if defined(__AVR__)
+#define OPENTHERM_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define OPENTHERM_MEMORY_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+class OpenThermArduinoPin
+{
+public:
+    void begin(int pin)
+    {
+        this->pin = pin;
+    }
+    inline int read() const
+    {
+        return digitalRead(pin);
+    }
+    inline void write(int value) const
+    {
+        digitalWrite(pin, value);
+    }
+
+private:
+    int pin;
+};
+
+#if defined(__AVR__)
+class OpenThermAvrPin
+{
+public:
+    void begin(int pin)
+    {
+        const uint8_t port = digitalPinToPort(pin);
+        mask = digitalPinToBitMask(pin);
+        in = portInputRegister(port);
+        out = portOutputRegister(port);
+    }
+    inline int read() const
+    {
+        return (*in & mask) ? HIGH : LOW;
+    }
+    inline void write(int value) const
+    {
+        // read-modify-write of the port must not be interrupted
+        const uint8_t oldSREG = SREG;
+        cli();
+        if (value == LOW)
+            *out &= ~mask;
+        else
+            *out |= mask;
+        SREG = oldSREG;
+    }
+
+private:
+    volatile uint8_t *in;
+    volatile uint8_t *out;
+    uint8_t mask;
+};
+#endif
+
+#if defined(ARDUINO_ARCH_ESP8266)
+class OpenThermEsp8266Pin
+{
+public:
+    void begin(int pin)
+    {
+        this->pin = pin;
+    }
+    inline int read() const
+    {
+        // GPIO16 is not on the GPIO register bank
+        return pin < 16 ? (GPI & (1 << pin) ? HIGH : LOW) : digitalRead(pin);
+    }
+    inline void write(int value) const
+    {
+        if (pin >= 16)
+            digitalWrite(pin, value);
+        else if (value == LOW)
+            GPOC = (1 << pin);
+        else
+            GPOS = (1 << pin);
+    }
+
+private:
+    int pin;
+};
+#endif
+
+#if defined(OPENTHERM_FAST_IO) && defined(ARDUINO_ARCH_ESP32)
+class OpenThermEsp32Pin
+{
+public:
+    void begin(int pin)
+    {
+        this->pin = (gpio_num_t)pin;
+    }
+    inline int read() const
+    {
+        return gpio_ll_get_level(&GPIO, pin);
+    }
+    inline void write(int value) const
+    {
+        gpio_ll_set_level(&GPIO, pin, value);
+    }
+
+private:
+    gpio_num_t pin;
+};
+#endif
+
+#if defined(OPENTHERM_PIN_CLASS)
+typedef OPENTHERM_PIN_CLASS OpenThermPin;
+#elif defined(OPENTHERM_HOST)
+typedef OpenThermHostPin OpenThermPin;
+#elif defined(OPENTHERM_FAST_IO) && defined(__AVR__)
+typedef OpenThermAvrPin OpenThermPin;
+#elif defined(OPENTHERM_FAST_IO) && defined(ARDUINO_ARCH_ESP8266)
+typedef OpenThermEsp8266Pin OpenThermPin;
+#elif defined(OPENTHERM_FAST_IO) && defined(ARDUINO_ARCH_ESP32)
+typedef OpenThermEsp32Pin OpenThermPin;
+#else
+typedef OpenThermArduinoPin OpenThermPin;
+#endif
+
+// Clock used for bit timing, us
+inline unsigned long openThermMicros()
+{
+#if defined(OPENTHERM_FAST_IO) && defined(ARDUINO_ARCH_ESP32)
+    return (unsigned long)esp_timer_get_time();
+#else
+    return micros();
+#endif
+}
+
+#endif // OpenThermHal_h
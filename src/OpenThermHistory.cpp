@@ -0,0 +1,231 @@
+/*
+OpenThermHistory.cpp - Fixed memory history of OpenTherm data IDs
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermHistory.h"
+
+static const unsigned long MINUTE = 60000UL;
+static const unsigned long HOUR = 3600000UL;
+
+OpenThermHistory::OpenThermHistory(OpenTherm &ot, OpenThermHistorySeries *series, byte count) :
+    ot(ot),
+    series(series),
+    count(count)
+{
+    listener.handler = handleResponse;
+    listener.context = this;
+    listener.next = NULL;
+}
+
+OpenThermHistory::~OpenThermHistory()
+{
+    end();
+}
+
+void OpenThermHistory::begin()
+{
+    clear();
+    ot.removeResponseListener(&listener);
+    ot.addResponseListener(&listener);
+}
+
+void OpenThermHistory::end()
+{
+    ot.removeResponseListener(&listener);
+}
+
+void OpenThermHistory::clear()
+{
+    for (byte i = 0; i < count; i++)
+    {
+        OpenThermHistorySeries &s = series[i];
+        beginUpdate(s);
+        s.sampleHead = 0;
+        s.sampleCount = 0;
+        s.minuteHead = 0;
+        s.minuteCount = 0;
+        s.hourHead = 0;
+        s.hourCount = 0;
+        endUpdate(s);
+    }
+}
+
+OpenThermHistorySeries *OpenThermHistory::getSeries(OpenThermMessageID id)
+{
+    for (byte i = 0; i < count; i++)
+    {
+        if (series[i].id == id)
+        {
+            return &series[i];
+        }
+    }
+    return NULL;
+}
+
+void OpenThermHistory::record(unsigned long response, unsigned long timestamp)
+{
+    OpenThermHistorySeries *s = getSeries(OpenTherm::getDataID(response));
+    if (s == NULL)
+    {
+        return;
+    }
+    const int16_t value = (int16_t)(response & 0xFFFF);
+
+    beginUpdate(*s);
+    if (s->sampleCapacity > 0)
+    {
+        if (s->sampleCount > 0)
+        {
+            s->sampleHead = s->sampleHead + 1 < s->sampleCapacity ? s->sampleHead + 1 : 0;
+        }
+        if (s->sampleCount < s->sampleCapacity)
+        {
+            s->sampleCount++;
+        }
+        s->samples[s->sampleHead].timestamp = timestamp;
+        s->samples[s->sampleHead].value = value;
+    }
+    add(s->minutes, s->minuteCapacity, s->minuteHead, s->minuteCount, MINUTE, value, timestamp);
+    add(s->hours, s->hourCapacity, s->hourHead, s->hourCount, HOUR, value, timestamp);
+    endUpdate(*s);
+}
+
+// odd sequence marks the update in progress, barriers keep the counter ordered with the buffers
+void OpenThermHistory::beginUpdate(OpenThermHistorySeries &s)
+{
+    s.sequence = s.sequence + 1;
+    OPENTHERM_MEMORY_BARRIER();
+}
+
+void OpenThermHistory::endUpdate(OpenThermHistorySeries &s)
+{
+    OPENTHERM_MEMORY_BARRIER();
+    s.sequence = s.sequence + 1;
+}
+
+// updates the newest bucket, or starts a new one when the sample is in the next period
+void OpenThermHistory::add(OpenThermHistoryBucket *buckets, byte capacity, byte &head, byte &size, unsigned long period, int16_t value, unsigned long timestamp)
+{
+    if (capacity == 0)
+    {
+        return;
+    }
+    OpenThermHistoryBucket &current = buckets[head];
+    if (size > 0 && current.timestamp / period == timestamp / period)
+    {
+        if (value < current.min)
+            current.min = value;
+        if (value > current.max)
+            current.max = value;
+        if (current.count < 0xFFFF)
+        {
+            current.sum += value;
+            current.count++;
+        }
+        return;
+    }
+
+    if (size > 0)
+    {
+        head = head + 1 < capacity ? head + 1 : 0;
+    }
+    if (size < capacity)
+    {
+        size++;
+    }
+    OpenThermHistoryBucket &bucket = buckets[head];
+    bucket.timestamp = timestamp;
+    bucket.min = value;
+    bucket.max = value;
+    bucket.sum = value;
+    bucket.count = 1;
+}
+
+byte OpenThermHistory::getCount(OpenThermMessageID id, OpenThermHistoryResolution resolution)
+{
+    const OpenThermHistorySeries *s = getSeries(id);
+    if (s == NULL)
+    {
+        return 0;
+    }
+    switch (resolution)
+    {
+    case OpenThermHistoryResolution::RAW:
+        return s->sampleCount;
+    case OpenThermHistoryResolution::MINUTE:
+        return s->minuteCount;
+    case OpenThermHistoryResolution::HOUR:
+        return s->hourCount;
+    }
+    return 0;
+}
+
+// Readers never block the writer: the entry is copied and the copy is repeated
+// if the sequence counter shows that the series was updated meanwhile. A reader
+// which preempted the writer would wait for it forever, so it gives up after
+// OPENTHERM_SEQUENCE_RETRIES attempts.
+bool OpenThermHistory::get(OpenThermMessageID id, OpenThermHistoryResolution resolution, byte index, OpenThermHistoryBucket &bucket)
+{
+    const OpenThermHistorySeries *s = getSeries(id);
+    if (s == NULL)
+    {
+        return false;
+    }
+
+    for (byte attempt = 0; attempt < OPENTHERM_SEQUENCE_RETRIES; attempt++)
+    {
+        const unsigned long sequence = s->sequence;
+        OPENTHERM_MEMORY_BARRIER();
+        bool found = false;
+        switch (resolution)
+        {
+        case OpenThermHistoryResolution::RAW:
+            if (index < s->sampleCount)
+            {
+                const byte position = s->sampleHead >= index ? s->sampleHead - index : s->sampleHead + s->sampleCapacity - index;
+                const OpenThermHistorySample &sample = s->samples[position];
+                bucket.timestamp = sample.timestamp;
+                bucket.min = sample.value;
+                bucket.max = sample.value;
+                bucket.sum = sample.value;
+                bucket.count = 1;
+                found = true;
+            }
+            break;
+        case OpenThermHistoryResolution::MINUTE:
+            if (index < s->minuteCount)
+            {
+                bucket = s->minutes[s->minuteHead >= index ? s->minuteHead - index : s->minuteHead + s->minuteCapacity - index];
+                found = true;
+            }
+            break;
+        case OpenThermHistoryResolution::HOUR:
+            if (index < s->hourCount)
+            {
+                bucket = s->hours[s->hourHead >= index ? s->hourHead - index : s->hourHead + s->hourCapacity - index];
+                found = true;
+            }
+            break;
+        }
+        OPENTHERM_MEMORY_BARRIER();
+        if ((sequence & 1) == 0 && sequence == s->sequence)
+        {
+            return found;
+        }
+    }
+    return false;
+}
+
+void OpenThermHistory::handleResponse(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    if (status != OpenThermResponseStatus::SUCCESS)
+    {
+        return;
+    }
+    const OpenThermMessageType type = OpenTherm::getMessageType(response);
+    if (type == OpenThermMessageType::READ_ACK || type == OpenThermMessageType::WRITE_ACK)
+    {
+        static_cast<OpenThermHistory *>(context)->record(response, millis());
+    }
+}
@@ -0,0 +1,92 @@
+/*
+OpenThermHistory.h - Fixed memory history of OpenTherm data IDs
+Copyright 2023, Ihor Melnyk
+
+Every valid response of a selected data ID is stored in ring buffers of raw
+samples, 1 minute and 1 hour buckets with min/max/average. Each sample updates
+the current buckets in place, older ones are overwritten. Buffers are provided
+by the caller, a buffer with zero capacity is not used.
+*/
+
+#ifndef OpenThermHistory_h
+#define OpenThermHistory_h
+
+#include "OpenTherm.h"
+
+enum class OpenThermHistoryResolution : byte
+{
+    RAW,
+    MINUTE,
+    HOUR
+};
+
+// values are raw 16 bit data as signed, f8.8 values are in 1/256 units
+struct OpenThermHistorySample
+{
+    unsigned long timestamp; // ms
+    int16_t value;
+};
+
+struct OpenThermHistoryBucket
+{
+    unsigned long timestamp; // ms of the first sample
+    int16_t min;
+    int16_t max;
+    long sum;
+    uint16_t count;
+
+    int16_t getAverage() const
+    {
+        return count > 0 ? sum / count : 0;
+    }
+};
+
+struct OpenThermHistorySeries
+{
+    OpenThermMessageID id;
+    OpenThermHistorySample *samples;
+    byte sampleCapacity;
+    OpenThermHistoryBucket *minutes;
+    byte minuteCapacity;
+    OpenThermHistoryBucket *hours;
+    byte hourCapacity;
+
+    // filled by history, head is the newest entry
+    byte sampleHead;
+    byte sampleCount;
+    byte minuteHead;
+    byte minuteCount;
+    byte hourHead;
+    byte hourCount;
+    volatile unsigned long sequence; // odd while an update is in progress
+};
+
+class OpenThermHistory
+{
+public:
+    OpenThermHistory(OpenTherm &ot, OpenThermHistorySeries *series, byte count);
+    ~OpenThermHistory();
+    void begin();
+    void end();
+    void clear();
+    // records a response, called by the response listener
+    void record(unsigned long response, unsigned long timestamp);
+    OpenThermHistorySeries *getSeries(OpenThermMessageID id);
+    byte getCount(OpenThermMessageID id, OpenThermHistoryResolution resolution);
+    // index 0 is the newest entry, raw samples are returned as buckets of one sample.
+    // Returns false also when the series was updated during every copy attempt.
+    bool get(OpenThermMessageID id, OpenThermHistoryResolution resolution, byte index, OpenThermHistoryBucket &bucket);
+
+private:
+    OpenTherm &ot;
+    OpenThermHistorySeries *series;
+    const byte count;
+    OpenThermResponseListener listener;
+
+    static void beginUpdate(OpenThermHistorySeries &s);
+    static void endUpdate(OpenThermHistorySeries &s);
+    static void add(OpenThermHistoryBucket *buckets, byte capacity, byte &head, byte &size, unsigned long period, int16_t value, unsigned long timestamp);
+    static void handleResponse(unsigned long response, OpenThermResponseStatus status, void *context);
+};
+
+#endif // OpenThermHistory_h
@@ -0,0 +1,145 @@
+/*
+OpenThermHost.h - Arduino API subset for building OpenTherm Library on Linux
+Copyright 2023, Ihor Melnyk
+
+Enabled with OPENTHERM_HOST. Pins are simulated, writing a pin with
+OpenThermHost::setPin() calls its attached interrupt handler, and time only
+moves with OpenThermHost::advance(), delay() and delayMicroseconds(), so
+bus traffic can be simulated faster than real time.
+*/
+
+#ifndef OpenThermHost_h
+#define OpenThermHost_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define CHANGE 3
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+
+class OpenThermHost
+{
+public:
+    static const int PINS = 64;
+
+    struct State
+    {
+        unsigned long micros;
+        int pins[PINS];
+        void (*handlers[PINS])(void);
+        void (*argHandlers[PINS])(void *);
+        void *args[PINS];
+        void (*onDelay)(unsigned long us); // called instead of advancing clock, e.g. to run a timer
+    };
+
+    static State &state()
+    {
+        static State instance;
+        return instance;
+    }
+
+    static void reset()
+    {
+        memset(&state(), 0, sizeof(State));
+    }
+
+    // set input level, calls interrupt handler if the level has changed
+    static void setPin(int pin, int value)
+    {
+        State &s = state();
+        if (s.pins[pin] == value)
+            return;
+        s.pins[pin] = value;
+        if (s.handlers[pin] != NULL)
+            s.handlers[pin]();
+        else if (s.argHandlers[pin] != NULL)
+            s.argHandlers[pin](s.args[pin]);
+    }
+
+    static void advance(unsigned long us)
+    {
+        state().micros += us;
+    }
+};
+
+inline void pinMode(int, int) {}
+inline int digitalRead(int pin) { return OpenThermHost::state().pins[pin]; }
+inline void digitalWrite(int pin, int value) { OpenThermHost::state().pins[pin] = value; }
+inline unsigned long micros() { return OpenThermHost::state().micros; }
+inline unsigned long millis() { return OpenThermHost::state().micros / 1000; }
+inline void delayMicroseconds(unsigned int us)
+{
+    OpenThermHost::State &s = OpenThermHost::state();
+    if (s.onDelay != NULL)
+        s.onDelay(us);
+    else
+        s.micros += us;
+}
+inline void delay(unsigned long ms) { delayMicroseconds(ms * 1000); }
+inline void yield() { delayMicroseconds(1); }
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int pin, void (*handler)(void), int) { OpenThermHost::state().handlers[pin] = handler; }
+inline void attachInterruptArg(int pin, void (*handler)(void *), void *arg, int)
+{
+    OpenThermHost::state().argHandlers[pin] = handler;
+    OpenThermHost::state().args[pin] = arg;
+}
+inline void detachInterrupt(int pin)
+{
+    OpenThermHost::state().handlers[pin] = NULL;
+    OpenThermHost::state().argHandlers[pin] = NULL;
+}
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (n < size && write(buffer[n]))
+            n++;
+        return n;
+    }
+    virtual int availableForWrite() { return 0; }
+};
+
+// program memory is ordinary memory on Linux
+class __FlashStringHelper;
+#define PROGMEM
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define memcpy_P memcpy
+
+class OpenThermHostPin
+{
+public:
+    void begin(int pin)
+    {
+        this->pin = pin;
+    }
+    inline int read() const
+    {
+        return digitalRead(pin);
+    }
+    inline void write(int value) const
+    {
+        digitalWrite(pin, value);
+    }
+
+private:
+    int pin;
+};
+
+#endif // OpenThermHost_h
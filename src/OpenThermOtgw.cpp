@@ -0,0 +1,317 @@
+/*
+OpenThermOtgw.cpp - OTGW/OpenTherm Monitor compatible serial line protocol
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermOtgw.h"
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+OpenThermOtgwWriter::OpenThermOtgwWriter(char *buffer, size_t size) :
+    buffer(buffer),
+    size(size),
+    head(0),
+    tail(0),
+    dropped(0),
+    lastRequest(0),
+    lastResponse(0)
+{
+}
+
+byte OpenThermOtgwWriter::formatFrame(char *line, char prefix, unsigned long frame)
+{
+    line[0] = prefix;
+    for (byte i = 0; i < 8; i++)
+    {
+        line[8 - i] = hexDigits[frame & 0xF];
+        frame >>= 4;
+    }
+    line[9] = '\r';
+    line[10] = '\n';
+    return FRAME_LINE_SIZE;
+}
+
+static byte formatCenti(char *text, int16_t value)
+{
+    byte length = 0;
+    long v = value;
+    if (v < 0)
+    {
+        text[length++] = '-';
+        v = -v;
+    }
+    char digits[5];
+    byte count = 0;
+    long integer = v / 100;
+    do
+    {
+        digits[count++] = '0' + integer % 10;
+        integer /= 10;
+    } while (integer > 0);
+    while (count > 0)
+    {
+        text[length++] = digits[--count];
+    }
+    text[length++] = '.';
+    text[length++] = '0' + (v / 10) % 10;
+    text[length++] = '0' + v % 10;
+    return length;
+}
+
+// longest reply is "XX: -327.68\r\n", 13 characters
+byte OpenThermOtgwWriter::formatReply(char *line, OpenThermOtgwStatus status, const OpenThermOtgwCommand &command)
+{
+    byte length = 0;
+    switch (status)
+    {
+    case OpenThermOtgwStatus::COMMAND:
+        line[length++] = command.code[0];
+        line[length++] = command.code[1];
+        line[length++] = ':';
+        line[length++] = ' ';
+        length += formatCenti(line + length, command.value);
+        break;
+    case OpenThermOtgwStatus::SYNTAX_ERROR:
+        line[length++] = 'S';
+        line[length++] = 'E';
+        break;
+    case OpenThermOtgwStatus::BAD_VALUE:
+        line[length++] = 'B';
+        line[length++] = 'V';
+        break;
+    case OpenThermOtgwStatus::OUT_OF_RANGE:
+        line[length++] = 'O';
+        line[length++] = 'R';
+        break;
+    default:
+        line[length++] = 'N';
+        line[length++] = 'G';
+        break;
+    }
+    line[length++] = '\r';
+    line[length++] = '\n';
+    return length;
+}
+
+bool OpenThermOtgwWriter::writeFrame(char prefix, unsigned long frame)
+{
+    char line[FRAME_LINE_SIZE];
+    return writeLine(line, formatFrame(line, prefix, frame));
+}
+
+#if OPENTHERM_SLAVE
+// R and A lines are written only when the gateway has changed the frame, like OTGW does
+bool OpenThermOtgwWriter::writeFrame(OpenThermGatewayFrame type, unsigned long frame)
+{
+    switch (type)
+    {
+    case OpenThermGatewayFrame::THERMOSTAT_REQUEST:
+        lastRequest = frame;
+        return writeFrame('T', frame);
+    case OpenThermGatewayFrame::BOILER_REQUEST:
+        return frame == lastRequest || writeFrame('R', frame);
+    case OpenThermGatewayFrame::BOILER_RESPONSE:
+        lastResponse = frame;
+        return writeFrame('B', frame);
+    case OpenThermGatewayFrame::THERMOSTAT_RESPONSE:
+        return frame == lastResponse || writeFrame('A', frame);
+    }
+    return false;
+}
+#endif
+
+bool OpenThermOtgwWriter::writeReply(OpenThermOtgwStatus status, const OpenThermOtgwCommand &command)
+{
+    char line[16];
+    return writeLine(line, formatReply(line, status, command));
+}
+
+bool OpenThermOtgwWriter::writeLine(const char *line, size_t length)
+{
+    // one byte is kept free to tell full buffer from empty one
+    if (length >= size - available())
+    {
+        dropped++;
+        return false;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        buffer[head] = line[i];
+        head = head + 1 < size ? head + 1 : 0;
+    }
+    return true;
+}
+
+size_t OpenThermOtgwWriter::available()
+{
+    return head >= tail ? head - tail : size - tail + head;
+}
+
+size_t OpenThermOtgwWriter::flush(Print &output)
+{
+    size_t n = 0;
+    int space = output.availableForWrite();
+    if (space <= 0)
+    {
+        // Print reports no free space unless the stream overrides availableForWrite(), it can't
+        // be told from a full stream, so both get a bounded chunk
+        space = OPENTHERM_FLUSH_CHUNK;
+    }
+    while (space > 0 && head != tail)
+    {
+        const size_t chunk = head >= tail ? head - tail : size - tail;
+        const size_t count = chunk < (size_t)space ? chunk : (size_t)space;
+        const size_t written = output.write((const uint8_t *)buffer + tail, count);
+        tail = (tail + written) % size;
+        n += written;
+        if (written < count)
+        {
+            break;
+        }
+        space -= written;
+    }
+    return n;
+}
+
+unsigned long OpenThermOtgwWriter::getDropped()
+{
+    return dropped;
+}
+
+#if OPENTHERM_SLAVE
+void OpenThermOtgwWriter::handleFrame(OpenThermGatewayFrame type, unsigned long frame, void *context)
+{
+    static_cast<OpenThermOtgwWriter *>(context)->writeFrame(type, frame);
+}
+#endif
+
+OpenThermOtgwParser::OpenThermOtgwParser() :
+    length(0),
+    overflow(false)
+{
+    command.code[0] = command.code[1] = command.code[2] = 0;
+    command.value = 0;
+}
+
+OpenThermOtgwStatus OpenThermOtgwParser::feed(char c)
+{
+    if (c == '\r' || c == '\n')
+    {
+        if (length == 0 && !overflow)
+        {
+            return OpenThermOtgwStatus::NONE;
+        }
+        const OpenThermOtgwStatus status = overflow ? OpenThermOtgwStatus::SYNTAX_ERROR : parse();
+        length = 0;
+        overflow = false;
+        return status;
+    }
+    if (length < OPENTHERM_OTGW_LINE_SIZE)
+    {
+        line[length++] = c;
+    }
+    else
+    {
+        overflow = true;
+    }
+    return OpenThermOtgwStatus::NONE;
+}
+
+const OpenThermOtgwCommand &OpenThermOtgwParser::getCommand()
+{
+    return command;
+}
+
+// "XX=[-]digits[.digits]", value is stored in 1/100 units, extra decimals are ignored
+OpenThermOtgwStatus OpenThermOtgwParser::parse()
+{
+    if (length < 4 || line[2] != '=' ||
+        line[0] < 'A' || line[0] > 'Z' || line[1] < 'A' || line[1] > 'Z')
+    {
+        return OpenThermOtgwStatus::SYNTAX_ERROR;
+    }
+    command.code[0] = line[0];
+    command.code[1] = line[1];
+    command.code[2] = 0;
+
+    byte i = 3;
+    const bool negative = line[i] == '-';
+    if (negative)
+    {
+        i++;
+    }
+    long value = 0;
+    byte digits = 0;
+    byte decimals = 0;
+    bool point = false;
+    for (; i < length; i++)
+    {
+        const char c = line[i];
+        if (c == '.' && !point)
+        {
+            point = true;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            digits++;
+            if (point && ++decimals > 2)
+            {
+                continue;
+            }
+            value = value * 10 + (c - '0');
+            if (value > 32767L * 100)
+            {
+                return OpenThermOtgwStatus::BAD_VALUE;
+            }
+        }
+        else
+        {
+            return OpenThermOtgwStatus::BAD_VALUE;
+        }
+    }
+    if (digits == 0)
+    {
+        return OpenThermOtgwStatus::BAD_VALUE;
+    }
+    for (; decimals < 2; decimals++)
+    {
+        value *= 10;
+    }
+    if (value > 32767)
+    {
+        return OpenThermOtgwStatus::BAD_VALUE;
+    }
+    command.value = negative ? -value : value;
+    return OpenThermOtgwStatus::COMMAND;
+}
+
+#if OPENTHERM_SLAVE
+OpenThermOtgwStatus OpenThermOtgwParser::apply(OpenThermGateway &gateway, const OpenThermOtgwCommand &command)
+{
+    OpenThermMessageID id;
+    if (command.code[0] == 'C' && command.code[1] == 'S')
+        id = OpenThermMessageID::TSet;
+    else if (command.code[0] == 'S' && command.code[1] == 'W')
+        id = OpenThermMessageID::TdhwSet;
+    else if (command.code[0] == 'M' && command.code[1] == 'M')
+        id = OpenThermMessageID::MaxRelModLevelSetting;
+    else
+        return OpenThermOtgwStatus::NO_GOOD;
+
+    if (command.value < 0 || command.value > 10000)
+    {
+        return OpenThermOtgwStatus::OUT_OF_RANGE;
+    }
+    if (command.value == 0)
+    {
+        gateway.clearRule(id);
+        return OpenThermOtgwStatus::COMMAND;
+    }
+    // thermostat writes these values, its writes are changed on the way to the boiler
+    if (!gateway.overrideWrite(id, (uint16_t)OpenTherm::centiToF88(command.value)))
+    {
+        return OpenThermOtgwStatus::NO_GOOD;
+    }
+    return OpenThermOtgwStatus::COMMAND;
+}
+#endif
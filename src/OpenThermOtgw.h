@@ -0,0 +1,91 @@
+/*
+OpenThermOtgw.h - OTGW/OpenTherm Monitor compatible serial line protocol
+Copyright 2023, Ihor Melnyk
+
+Frames are written as lines of prefix and 8 hex digits, e.g. "T80000200\r\n":
+T - thermostat request, B - boiler response,
+R - request sent to boiler and A - response sent to thermostat when changed by the gateway.
+Commands are lines like "CS=60.5", answered with "CS: 60.50" or an error code.
+No dynamic memory is used.
+*/
+
+#ifndef OpenThermOtgw_h
+#define OpenThermOtgw_h
+
+#include "OpenTherm.h"
+#include "OpenThermGateway.h"
+
+enum class OpenThermOtgwStatus : byte
+{
+    NONE,          // line is not complete yet
+    COMMAND,       // command is available
+    SYNTAX_ERROR,  // "SE"
+    BAD_VALUE,     // "BV"
+    NO_GOOD,       // "NG", unknown command
+    OUT_OF_RANGE   // "OR"
+};
+
+struct OpenThermOtgwCommand
+{
+    char code[3];
+    int16_t value; // 1/100 units
+};
+
+class OpenThermOtgwWriter
+{
+public:
+    static const byte FRAME_LINE_SIZE = 11;
+
+    OpenThermOtgwWriter(char *buffer, size_t size);
+    // lines which don't fit into the buffer are dropped as a whole
+    bool writeFrame(char prefix, unsigned long frame);
+#if OPENTHERM_SLAVE
+    bool writeFrame(OpenThermGatewayFrame type, unsigned long frame);
+#endif
+    bool writeLine(const char *line, size_t length);
+    bool writeReply(OpenThermOtgwStatus status, const OpenThermOtgwCommand &command);
+    // writes as much as output accepts without blocking, OPENTHERM_FLUSH_CHUNK bytes to a stream
+    // which doesn't report its free space
+    size_t flush(Print &output);
+    size_t available();
+    unsigned long getDropped();
+
+#if OPENTHERM_SLAVE
+    // gateway.setFrameHandler(OpenThermOtgwWriter::handleFrame, &writer)
+    static void handleFrame(OpenThermGatewayFrame type, unsigned long frame, void *context);
+#endif
+    static byte formatFrame(char *line, char prefix, unsigned long frame);
+    static byte formatReply(char *line, OpenThermOtgwStatus status, const OpenThermOtgwCommand &command);
+
+private:
+    char *buffer;
+    const size_t size;
+    size_t head;
+    size_t tail;
+    unsigned long dropped;
+    unsigned long lastRequest;
+    unsigned long lastResponse;
+};
+
+class OpenThermOtgwParser
+{
+public:
+    OpenThermOtgwParser();
+    // accepts input a character at a time, returns COMMAND or an error when a line is complete
+    OpenThermOtgwStatus feed(char c);
+    const OpenThermOtgwCommand &getCommand();
+    // supported commands: CS - CH water setpoint, SW - DHW setpoint, MM - max modulation, value 0 cancels override
+#if OPENTHERM_SLAVE
+    static OpenThermOtgwStatus apply(OpenThermGateway &gateway, const OpenThermOtgwCommand &command);
+#endif
+
+private:
+    char line[OPENTHERM_OTGW_LINE_SIZE];
+    byte length;
+    bool overflow;
+    OpenThermOtgwCommand command;
+
+    OpenThermOtgwStatus parse();
+};
+
+#endif // OpenThermOtgw_h
@@ -0,0 +1,175 @@
+/*
+OpenThermScheduler.cpp - Periodic polling of OpenTherm data IDs
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermScheduler.h"
+
+OpenThermScheduler::OpenThermScheduler(OpenTherm &ot, OpenThermPollEntry *entries, byte count) :
+    ot(ot),
+    entries(entries),
+    count(count),
+    pending(NULL),
+    handler(NULL),
+    context(NULL)
+{
+}
+
+void OpenThermScheduler::begin()
+{
+    const unsigned long now = millis();
+    for (byte i = 0; i < count; i++)
+    {
+        OpenThermPollEntry &entry = entries[i];
+        if (entry.id == OpenThermMessageID::Status && (entry.period == 0 || entry.period > OPENTHERM_STATUS_MAX_PERIOD))
+        {
+            entry.period = OPENTHERM_STATUS_MAX_PERIOD;
+        }
+        entry.deadline = now;
+        entry.lastRequestTimestamp = 0;
+        entry.achievedPeriod = 0;
+        entry.jitter = 0;
+        entry.maxJitter = 0;
+        entry.misses = 0;
+        entry.response = 0;
+        entry.responseStatus = OpenThermResponseStatus::NONE;
+    }
+    pending = NULL;
+}
+
+void OpenThermScheduler::begin(OpenThermResponseHandler handler, void *context)
+{
+    begin();
+    this->handler = handler;
+    this->context = context;
+}
+
+void OpenThermScheduler::process()
+{
+    // requests are queued one at a time at the last moment, so the choice is made with the latest deadlines
+    if (pending != NULL || ot.getQueueDepth() > 0 || !ot.isReady())
+    {
+        return;
+    }
+
+    const unsigned long now = millis();
+    OpenThermPollEntry *entry = nextEntry(now);
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    pending = entry;
+    updateTiming(*entry, now);
+    if (!ot.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, entry->id, entry->data), handleResponse, this))
+    {
+        pending = NULL;
+    }
+}
+
+OpenThermPollEntry *OpenThermScheduler::nextEntry(unsigned long now)
+{
+    OpenThermPollEntry *next = NULL;
+    for (byte i = 0; i < count; i++)
+    {
+        OpenThermPollEntry &entry = entries[i];
+        if ((long)(now - entry.deadline) < 0 || !ot.isIdSupported(entry.id))
+        {
+            continue;
+        }
+        // Status is always sent first when due to keep the 1s communication requirement
+        if (entry.id == OpenThermMessageID::Status)
+        {
+            return &entry;
+        }
+        if (next == NULL)
+        {
+            next = &entry;
+            continue;
+        }
+        const long diff = (long)(entry.deadline - next->deadline);
+        if (diff < 0 || (diff == 0 && entry.priority > next->priority))
+        {
+            next = &entry;
+        }
+    }
+    return next;
+}
+
+void OpenThermScheduler::updateTiming(OpenThermPollEntry &entry, unsigned long now)
+{
+    if (entry.lastRequestTimestamp != 0)
+    {
+        const unsigned long interval = now - entry.lastRequestTimestamp;
+        const unsigned long deviation = interval > entry.period ? interval - entry.period : entry.period - interval;
+        if (entry.achievedPeriod == 0)
+        {
+            entry.achievedPeriod = interval;
+        }
+        else
+        {
+            entry.achievedPeriod = entry.achievedPeriod - (entry.achievedPeriod >> 3) + (interval >> 3);
+        }
+        entry.jitter = entry.jitter - (entry.jitter >> 3) + (deviation >> 3);
+        if (deviation > entry.maxJitter)
+        {
+            entry.maxJitter = deviation;
+        }
+    }
+    entry.lastRequestTimestamp = now;
+
+    // keep the cadence, but don't try to catch up on missed periods
+    entry.deadline += entry.period;
+    if ((long)(now - entry.deadline) >= 0)
+    {
+        entry.misses++;
+        entry.deadline = now + entry.period;
+    }
+}
+
+void OpenThermScheduler::handleResponse(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    OpenThermScheduler *scheduler = static_cast<OpenThermScheduler *>(context);
+    OpenThermPollEntry *entry = scheduler->pending;
+    scheduler->pending = NULL;
+    if (entry == NULL)
+    {
+        return;
+    }
+    entry->response = response;
+    entry->responseStatus = status;
+    if (scheduler->handler != NULL)
+    {
+        scheduler->handler(response, status, scheduler->context);
+    }
+}
+
+OpenThermPollEntry *OpenThermScheduler::getEntry(OpenThermMessageID id)
+{
+    for (byte i = 0; i < count; i++)
+    {
+        if (entries[i].id == id)
+        {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+unsigned long OpenThermScheduler::getAchievedPeriod(OpenThermMessageID id)
+{
+    OpenThermPollEntry *entry = getEntry(id);
+    return entry != NULL ? entry->achievedPeriod : 0;
+}
+
+unsigned long OpenThermScheduler::getJitter(OpenThermMessageID id)
+{
+    OpenThermPollEntry *entry = getEntry(id);
+    return entry != NULL ? entry->jitter : 0;
+}
+
+unsigned long OpenThermScheduler::getMisses(OpenThermMessageID id)
+{
+    OpenThermPollEntry *entry = getEntry(id);
+    return entry != NULL ? entry->misses : 0;
+}
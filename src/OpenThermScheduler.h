@@ -0,0 +1,57 @@
+/*
+OpenThermScheduler.h - Periodic polling of OpenTherm data IDs
+Copyright 2023, Ihor Melnyk
+
+Emits read requests for a table of data IDs in earliest deadline first order
+using the request queue of OpenTherm instance.
+*/
+
+#ifndef OpenThermScheduler_h
+#define OpenThermScheduler_h
+
+#include "OpenTherm.h"
+
+struct OpenThermPollEntry
+{
+    OpenThermMessageID id;
+    unsigned long period;  // ms
+    byte priority;         // used to order entries with the same deadline, higher first
+    unsigned int data;     // request data, e.g. master status flags for Status
+
+    // filled by scheduler
+    unsigned long deadline;
+    unsigned long lastRequestTimestamp;
+    unsigned long achievedPeriod; // smoothed interval between requests, ms
+    unsigned long jitter;         // smoothed deviation of achieved period from configured period, ms
+    unsigned long maxJitter;      // ms
+    unsigned long misses;         // requests sent a whole period or more after their deadline
+    unsigned long response;
+    OpenThermResponseStatus responseStatus;
+};
+
+class OpenThermScheduler
+{
+public:
+    OpenThermScheduler(OpenTherm &ot, OpenThermPollEntry *entries, byte count);
+    void begin();
+    void begin(OpenThermResponseHandler handler, void *context = NULL);
+    void process();
+    OpenThermPollEntry *getEntry(OpenThermMessageID id);
+    unsigned long getAchievedPeriod(OpenThermMessageID id);
+    unsigned long getJitter(OpenThermMessageID id);
+    unsigned long getMisses(OpenThermMessageID id);
+
+private:
+    OpenTherm &ot;
+    OpenThermPollEntry *entries;
+    const byte count;
+    OpenThermPollEntry *pending;
+    OpenThermResponseHandler handler;
+    void *context;
+
+    OpenThermPollEntry *nextEntry(unsigned long now);
+    void updateTiming(OpenThermPollEntry &entry, unsigned long now);
+    static void handleResponse(unsigned long response, OpenThermResponseStatus status, void *context);
+};
+
+#endif // OpenThermScheduler_h
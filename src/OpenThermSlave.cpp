@@ -0,0 +1,193 @@
+/*
+OpenThermSlave.cpp - Table driven OpenTherm slave (boiler) emulation
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermSlave.h"
+
+#if OPENTHERM_SLAVE
+
+OpenThermSlave::OpenThermSlave(OpenTherm &ot) :
+    ot(ot),
+    handler(NULL),
+    handlerContext(NULL),
+    pendingResponse(0),
+    requestTimestamp(0),
+    lastLatency(0),
+    minLatency(0),
+    maxLatency(0),
+    averageLatency(0),
+    responseCount(0)
+{
+    memset(values, 0, sizeof(values));
+    memset(flags, 0, sizeof(flags));
+    listener.handler = handleRequest;
+    listener.context = this;
+    listener.next = NULL;
+}
+
+void OpenThermSlave::begin()
+{
+    ot.removeResponseListener(&listener);
+    ot.addResponseListener(&listener);
+}
+
+void OpenThermSlave::process()
+{
+    ot.process();
+    // slave is ready 20ms after request, which is the earliest allowed response time
+    if (pendingResponse != 0 && ot.isReady())
+    {
+        const unsigned long latency = openThermMicros() - requestTimestamp;
+        if (ot.sendResponse(pendingResponse))
+        {
+            recordLatency(latency);
+        }
+        pendingResponse = 0;
+    }
+}
+
+void OpenThermSlave::setValue(OpenThermMessageID id, uint16_t value, OpenThermDataAccess access)
+{
+    values[(byte)id] = value;
+    flags[(byte)id] = (flags[(byte)id] & HANDLED) | SUPPORTED |
+        (((byte)access & (byte)OpenThermDataAccess::READ) ? READABLE : 0) |
+        (((byte)access & (byte)OpenThermDataAccess::WRITE) ? WRITABLE : 0);
+}
+
+void OpenThermSlave::setFloat(OpenThermMessageID id, float value, OpenThermDataAccess access)
+{
+    setValue(id, (uint16_t)(int16_t)(value * 256), access);
+}
+
+uint16_t OpenThermSlave::getValue(OpenThermMessageID id)
+{
+    return values[(byte)id];
+}
+
+float OpenThermSlave::getFloat(OpenThermMessageID id)
+{
+    return OpenTherm::getFloat(values[(byte)id]);
+}
+
+void OpenThermSlave::setCenti(OpenThermMessageID id, int16_t value, OpenThermDataAccess access)
+{
+    setValue(id, (uint16_t)OpenTherm::centiToF88(value), access);
+}
+
+int16_t OpenThermSlave::getCenti(OpenThermMessageID id)
+{
+    return OpenTherm::f88ToCenti((int16_t)values[(byte)id]);
+}
+
+void OpenThermSlave::setSupported(OpenThermMessageID id, bool supported)
+{
+    if (supported)
+        flags[(byte)id] |= SUPPORTED;
+    else
+        flags[(byte)id] &= ~SUPPORTED;
+}
+
+bool OpenThermSlave::isSupported(OpenThermMessageID id)
+{
+    return flags[(byte)id] & SUPPORTED;
+}
+
+void OpenThermSlave::setHandler(OpenThermSlaveHandler handler, void *context)
+{
+    this->handler = handler;
+    this->handlerContext = context;
+}
+
+void OpenThermSlave::enableHandler(OpenThermMessageID id, bool enable)
+{
+    if (enable)
+        flags[(byte)id] |= HANDLED;
+    else
+        flags[(byte)id] &= ~HANDLED;
+}
+
+unsigned long OpenThermSlave::getLastLatency()
+{
+    return lastLatency;
+}
+
+unsigned long OpenThermSlave::getMinLatency()
+{
+    return minLatency;
+}
+
+unsigned long OpenThermSlave::getMaxLatency()
+{
+    return maxLatency;
+}
+
+unsigned long OpenThermSlave::getAverageLatency()
+{
+    return averageLatency;
+}
+
+unsigned long OpenThermSlave::getResponseCount()
+{
+    return responseCount;
+}
+
+unsigned long OpenThermSlave::buildResponse(unsigned long request)
+{
+    const OpenThermMessageType type = OpenTherm::getMessageType(request);
+    const OpenThermMessageID id = OpenTherm::getDataID(request);
+    const byte index = (byte)id;
+    const byte idFlags = flags[index];
+    uint16_t data = OpenTherm::getUInt(request);
+
+    if ((idFlags & HANDLED) && handler != NULL)
+    {
+        const OpenThermMessageType responseType = handler(type, id, data, handlerContext);
+        return OpenTherm::buildResponse(responseType, id, data);
+    }
+
+    if (type == OpenThermMessageType::READ_DATA && (idFlags & (SUPPORTED | READABLE)) == (SUPPORTED | READABLE))
+    {
+        if (id == OpenThermMessageID::Status)
+        {
+            // master status flags are in high byte of request, slave status flags in low byte of response
+            values[index] = (data & 0xFF00) | (values[index] & 0x00FF);
+        }
+        return OpenTherm::buildResponse(OpenThermMessageType::READ_ACK, id, values[index]);
+    }
+    if (type == OpenThermMessageType::WRITE_DATA && (idFlags & (SUPPORTED | WRITABLE)) == (SUPPORTED | WRITABLE))
+    {
+        values[index] = data;
+        return OpenTherm::buildResponse(OpenThermMessageType::WRITE_ACK, id, data);
+    }
+    return OpenTherm::buildResponse(OpenThermMessageType::UNKNOWN_DATA_ID, id, data);
+}
+
+void OpenThermSlave::recordLatency(unsigned long latency)
+{
+    lastLatency = latency;
+    if (responseCount == 0 || latency < minLatency)
+    {
+        minLatency = latency;
+    }
+    if (latency > maxLatency)
+    {
+        maxLatency = latency;
+    }
+    // smoothed average, a plain sum would overflow in long running slaves
+    averageLatency = responseCount == 0 ? latency : averageLatency - (averageLatency >> 4) + (latency >> 4);
+    responseCount++;
+}
+
+void OpenThermSlave::handleRequest(unsigned long request, OpenThermResponseStatus status, void *context)
+{
+    if (status != OpenThermResponseStatus::SUCCESS)
+    {
+        return;
+    }
+    OpenThermSlave *slave = static_cast<OpenThermSlave *>(context);
+    slave->requestTimestamp = slave->ot.getLastFrameTimestamp();
+    slave->pendingResponse = slave->buildResponse(request);
+}
+
+#endif // OPENTHERM_SLAVE
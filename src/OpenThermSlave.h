@@ -0,0 +1,75 @@
+/*
+OpenThermSlave.h - Table driven OpenTherm slave (boiler) emulation
+Copyright 2023, Ihor Melnyk
+
+Responses are built from a data table indexed by data ID. Reads of supported
+IDs are answered with READ_ACK, writes update the table and are answered with
+WRITE_ACK, anything else gets UNKNOWN_DATA_ID. Selected IDs can be handled by
+a user function.
+*/
+
+#ifndef OpenThermSlave_h
+#define OpenThermSlave_h
+
+#include "OpenTherm.h"
+#include "OpenThermCodec.h"
+
+#if OPENTHERM_SLAVE
+
+// Returns response message type, data can be changed to the value to respond with
+typedef OpenThermMessageType (*OpenThermSlaveHandler)(OpenThermMessageType type, OpenThermMessageID id, uint16_t &data, void *context);
+
+class OpenThermSlave
+{
+public:
+    OpenThermSlave(OpenTherm &ot);
+    void begin();
+    void process();
+
+    void setValue(OpenThermMessageID id, uint16_t value, OpenThermDataAccess access = OpenThermDataAccess::READ);
+    void setFloat(OpenThermMessageID id, float value, OpenThermDataAccess access = OpenThermDataAccess::READ);
+    uint16_t getValue(OpenThermMessageID id);
+    float getFloat(OpenThermMessageID id);
+    void setCenti(OpenThermMessageID id, int16_t value, OpenThermDataAccess access = OpenThermDataAccess::READ);
+    int16_t getCenti(OpenThermMessageID id);
+    void setSupported(OpenThermMessageID id, bool supported);
+    bool isSupported(OpenThermMessageID id);
+    void setHandler(OpenThermSlaveHandler handler, void *context = NULL);
+    void enableHandler(OpenThermMessageID id, bool enable = true);
+
+    // time from the end of request to the start of response, us
+    unsigned long getLastLatency();
+    unsigned long getMinLatency();
+    unsigned long getMaxLatency();
+    unsigned long getAverageLatency();
+    unsigned long getResponseCount();
+
+private:
+    static const byte SUPPORTED = 0x01;
+    static const byte READABLE = 0x02;
+    static const byte WRITABLE = 0x04;
+    static const byte HANDLED = 0x08;
+
+    OpenTherm &ot;
+    uint16_t values[256];
+    byte flags[256];
+    OpenThermSlaveHandler handler;
+    void *handlerContext;
+    OpenThermResponseListener listener;
+
+    unsigned long pendingResponse;
+    unsigned long requestTimestamp;
+    unsigned long lastLatency;
+    unsigned long minLatency;
+    unsigned long maxLatency;
+    unsigned long averageLatency;
+    unsigned long responseCount;
+
+    unsigned long buildResponse(unsigned long request);
+    void recordLatency(unsigned long latency);
+    static void handleRequest(unsigned long request, OpenThermResponseStatus status, void *context);
+};
+
+#endif // OPENTHERM_SLAVE
+
+#endif // OpenThermSlave_h
@@ -0,0 +1,150 @@
+/*
+OpenThermSubscriptions.cpp - Change notifications for OpenTherm data IDs
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermSubscriptions.h"
+
+OpenThermSubscriptions::OpenThermSubscriptions(OpenTherm &ot) :
+    ot(ot),
+    freeHead(0)
+{
+    listener.handler = handleResponse;
+    listener.context = this;
+    listener.next = NULL;
+    memset(heads, NONE, sizeof(heads));
+    for (byte i = 0; i < OPENTHERM_SUBSCRIPTIONS; i++)
+    {
+        pool[i].handler = NULL;
+        pool[i].next = i + 1 < OPENTHERM_SUBSCRIPTIONS ? i + 1 : NONE;
+    }
+}
+
+OpenThermSubscriptions::~OpenThermSubscriptions()
+{
+    end();
+}
+
+void OpenThermSubscriptions::begin()
+{
+    ot.removeResponseListener(&listener);
+    ot.addResponseListener(&listener);
+}
+
+void OpenThermSubscriptions::end()
+{
+    ot.removeResponseListener(&listener);
+}
+
+OpenThermSubscription *OpenThermSubscriptions::subscribe(OpenThermMessageID id, OpenThermChangeHandler handler, void *context, uint16_t deadband)
+{
+    return add(id, 0xFFFF, deadband, handler, context);
+}
+
+OpenThermSubscription *OpenThermSubscriptions::subscribeFlags(OpenThermMessageID id, uint16_t mask, OpenThermChangeHandler handler, void *context)
+{
+    return add(id, mask, 0, handler, context);
+}
+
+OpenThermSubscription *OpenThermSubscriptions::add(OpenThermMessageID id, uint16_t mask, uint16_t deadband, OpenThermChangeHandler handler, void *context)
+{
+    if ((byte)id >= sizeof(heads) || handler == NULL || freeHead == NONE)
+    {
+        return NULL;
+    }
+    const byte index = freeHead;
+    OpenThermSubscription &subscription = pool[index];
+    freeHead = subscription.next;
+
+    subscription.id = id;
+    subscription.mask = mask;
+    subscription.deadband = deadband;
+    subscription.handler = handler;
+    subscription.context = context;
+    subscription.value = 0;
+    subscription.valid = false;
+    subscription.next = heads[(byte)id];
+    heads[(byte)id] = index;
+    return &subscription;
+}
+
+void OpenThermSubscriptions::unsubscribe(OpenThermSubscription *subscription)
+{
+    if (subscription == NULL || subscription < pool || subscription >= pool + OPENTHERM_SUBSCRIPTIONS || subscription->handler == NULL)
+    {
+        return;
+    }
+    const byte index = subscription - pool;
+    byte *link = &heads[(byte)subscription->id];
+    while (*link != NONE && *link != index)
+    {
+        link = &pool[*link].next;
+    }
+    if (*link == index)
+    {
+        *link = subscription->next;
+    }
+    subscription->handler = NULL;
+    subscription->next = freeHead;
+    freeHead = index;
+}
+
+bool OpenThermSubscriptions::isChanged(const OpenThermSubscription &subscription, uint16_t value)
+{
+    if (!subscription.valid)
+    {
+        return true;
+    }
+    if (subscription.mask != 0xFFFF)
+    {
+        return value != subscription.value;
+    }
+    const long difference = (long)(int16_t)value - (int16_t)subscription.value;
+    return (difference < 0 ? -difference : difference) > subscription.deadband;
+}
+
+// Only subscriptions of the response ID are visited. The deadband is measured from the
+// last notified value, so slow drift is reported once it adds up.
+// A handler may unsubscribe itself, so the next index is saved before it is called.
+// If it unsubscribed the saved one too, that entry is in the free list or reused
+// for another ID, and the rest of the chain is notified by the next response.
+void OpenThermSubscriptions::dispatch(unsigned long response)
+{
+    const byte id = (byte)OpenTherm::getDataID(response);
+    if (id >= sizeof(heads))
+    {
+        return;
+    }
+    byte index = heads[id];
+    while (index != NONE)
+    {
+        OpenThermSubscription &subscription = pool[index];
+        if (subscription.handler == NULL || (byte)subscription.id != id)
+        {
+            return;
+        }
+        index = subscription.next;
+        const uint16_t value = response & subscription.mask;
+        if (!isChanged(subscription, value))
+        {
+            continue;
+        }
+        const uint16_t previous = subscription.valid ? subscription.value : value;
+        subscription.value = value;
+        subscription.valid = true;
+        subscription.handler(response, previous, subscription.context);
+    }
+}
+
+void OpenThermSubscriptions::handleResponse(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    if (status != OpenThermResponseStatus::SUCCESS)
+    {
+        return;
+    }
+    const OpenThermMessageType type = OpenTherm::getMessageType(response);
+    if (type == OpenThermMessageType::READ_ACK || type == OpenThermMessageType::WRITE_ACK)
+    {
+        static_cast<OpenThermSubscriptions *>(context)->dispatch(response);
+    }
+}
@@ -0,0 +1,65 @@
+/*
+OpenThermSubscriptions.h - Change notifications for OpenTherm data IDs
+Copyright 2023, Ihor Melnyk
+
+Handlers are registered for a data ID and called only when its value changes:
+by more than a deadband for numeric values, or in any of the selected bits for
+flags. Subscriptions are taken from a fixed pool and chained per data ID, so a
+response is dispatched only to the handlers of its own ID.
+*/
+
+#ifndef OpenThermSubscriptions_h
+#define OpenThermSubscriptions_h
+
+#include "OpenTherm.h"
+
+// previous is the last notified value, equal to the current one on the first notification
+typedef void (*OpenThermChangeHandler)(unsigned long response, uint16_t previous, void *context);
+
+struct OpenThermSubscription
+{
+    OpenThermMessageID id;
+    uint16_t mask;      // compared bits, 0xFFFF for numeric values
+    uint16_t deadband;  // raw units, e.g. 128 for 0.5 of f8.8 value, used when mask is 0xFFFF
+    OpenThermChangeHandler handler;
+    void *context;
+
+    // filled by subscriptions
+    uint16_t value;     // last notified value, masked
+    bool valid;
+    byte next;          // next subscription of the same ID, or free one
+};
+
+class OpenThermSubscriptions
+{
+public:
+    static const byte NONE = 0xFF;
+
+    OpenThermSubscriptions(OpenTherm &ot);
+    ~OpenThermSubscriptions();
+    void begin();
+    void end();
+    // numeric values are compared as signed 16 bit, change must be bigger than deadband
+    OpenThermSubscription *subscribe(OpenThermMessageID id, OpenThermChangeHandler handler, void *context = NULL, uint16_t deadband = 0);
+    // e.g. flame on: subscribeFlags(OpenThermMessageID::Status, 0x0008, handler)
+    OpenThermSubscription *subscribeFlags(OpenThermMessageID id, uint16_t mask, OpenThermChangeHandler handler, void *context = NULL);
+    // may be called from a handler, also for other subscriptions of the same ID
+    void unsubscribe(OpenThermSubscription *subscription);
+    // dispatches a response, called by the response listener
+    void dispatch(unsigned long response);
+
+private:
+    static_assert(OPENTHERM_SUBSCRIPTIONS < NONE, "OPENTHERM_SUBSCRIPTIONS must be less than 255");
+
+    OpenTherm &ot;
+    OpenThermResponseListener listener;
+    OpenThermSubscription pool[OPENTHERM_SUBSCRIPTIONS];
+    byte heads[128];    // first subscription of each data ID
+    byte freeHead;
+
+    OpenThermSubscription *add(OpenThermMessageID id, uint16_t mask, uint16_t deadband, OpenThermChangeHandler handler, void *context);
+    static bool isChanged(const OpenThermSubscription &subscription, uint16_t value);
+    static void handleResponse(unsigned long response, OpenThermResponseStatus status, void *context);
+};
+
+#endif // OpenThermSubscriptions_h
@@ -0,0 +1,255 @@
+/*
+OpenThermTable.cpp - Background reading of indexed OpenTherm data
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermTable.h"
+
+OpenThermTableReader::OpenThermTableReader(OpenTherm &ot, OpenThermTable *tables, byte count) :
+    ot(ot),
+    tables(tables),
+    count(count),
+    next(0),
+    pending(NULL),
+    pendingIndex(0)
+{
+}
+
+void OpenThermTableReader::begin()
+{
+    for (byte i = 0; i < count; i++)
+    {
+        OpenThermTable &table = tables[i];
+        table.state = OpenThermTableState::SIZE;
+        table.size = 0;
+        table.requested = 0;
+        table.fetched = 0;
+        table.timestamp = 0;
+        table.failures = 0;
+        table.skipped = 0;
+    }
+    pending = NULL;
+}
+
+// Requests are sent one at a time when the bus is otherwise idle, so periodic
+// polling and the Status exchange are not delayed by long tables.
+void OpenThermTableReader::process()
+{
+    if (pending != NULL || ot.getQueueDepth() > 0 || !ot.isReady())
+    {
+        return;
+    }
+
+    const unsigned long now = millis();
+    for (byte n = 0; n < count; n++)
+    {
+        byte i = next + n;
+        if (i >= count)
+        {
+            i -= count;
+        }
+        if (request(tables[i], now))
+        {
+            next = i + 1 < count ? i + 1 : 0;
+            return;
+        }
+    }
+}
+
+bool OpenThermTableReader::request(OpenThermTable &table, unsigned long now)
+{
+    switch (table.state)
+    {
+    case OpenThermTableState::COMPLETE:
+        if (table.period == 0 || now - table.timestamp < table.period)
+        {
+            return false;
+        }
+        // values are kept until overwritten by the new pass
+        table.state = OpenThermTableState::SIZE;
+        break;
+    case OpenThermTableState::UNSUPPORTED:
+        return false;
+    default:
+        if (table.timestamp != 0 && now - table.timestamp < OPENTHERM_TABLE_RETRY_DELAY)
+        {
+            return false;
+        }
+        break;
+    }
+
+    unsigned long frame;
+    if (table.state == OpenThermTableState::SIZE)
+    {
+        pendingIndex = 0;
+        frame = OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, table.sizeId, 0);
+    }
+    else
+    {
+        pendingIndex = table.requested;
+        frame = OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, table.valueId, (unsigned int)pendingIndex << 8);
+    }
+    pending = &table;
+    if (!ot.enqueueRequest(frame, handleResponse, this))
+    {
+        pending = NULL;
+        return false;
+    }
+    return true;
+}
+
+void OpenThermTableReader::handleResponse(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    static_cast<OpenThermTableReader *>(context)->handleResponse(response, status);
+}
+
+void OpenThermTableReader::handleResponse(unsigned long response, OpenThermResponseStatus status)
+{
+    OpenThermTable *table = pending;
+    pending = NULL;
+    if (table == NULL)
+    {
+        return;
+    }
+
+    const bool isSize = table->state == OpenThermTableState::SIZE;
+    const bool isString = table->sizeId == table->valueId;
+    if (status != OpenThermResponseStatus::SUCCESS)
+    {
+        // a corrupted frame is only a failed request, an intact answer of the slave is trusted
+        const bool answered = status == OpenThermResponseStatus::INVALID && !OpenTherm::parity(response) &&
+            OpenTherm::getDataID(response) == (isSize ? table->sizeId : table->valueId);
+        const OpenThermMessageType type = OpenTherm::getMessageType(response);
+        if (answered && type == OpenThermMessageType::UNKNOWN_DATA_ID)
+        {
+            table->state = OpenThermTableState::UNSUPPORTED;
+            return;
+        }
+        table->timestamp = millis();
+        if (!isSize && ((answered && type == OpenThermMessageType::DATA_INVALID) || ++table->failures >= OPENTHERM_TABLE_RETRIES))
+        {
+            skip(*table, pendingIndex);
+        }
+        return;
+    }
+
+    const byte hb = (response >> 8) & 0xFF;
+    const byte lb = response & 0xFF;
+    table->timestamp = 0;
+
+    if (isSize)
+    {
+        table->size = hb;
+        table->skipped = 0;
+        table->state = OpenThermTableState::ENTRIES;
+        if (isString && hb > 0)
+        {
+            // first character comes with the size
+            if (table->capacity > 0)
+            {
+                table->values[0] = lb;
+            }
+            advance(*table, 1);
+        }
+        else
+        {
+            advance(*table, 0);
+        }
+    }
+    else
+    {
+        if (!isString && hb != pendingIndex)
+        {
+            // slave answered another index, ask again
+            table->timestamp = millis();
+            if (++table->failures >= OPENTHERM_TABLE_RETRIES)
+            {
+                skip(*table, pendingIndex);
+            }
+            return;
+        }
+        if (pendingIndex < table->capacity)
+        {
+            table->values[pendingIndex] = lb;
+        }
+        advance(*table, pendingIndex + 1);
+    }
+}
+
+// moves to the next entry, the table is complete once all entries which fit into its buffer are read
+void OpenThermTableReader::advance(OpenThermTable &table, byte fetched)
+{
+    table.fetched = fetched;
+    table.requested = fetched;
+    table.failures = 0;
+    if (table.fetched >= getLength(table))
+    {
+        table.state = OpenThermTableState::COMPLETE;
+        table.timestamp = millis();
+    }
+}
+
+// slave rejects the index or doesn't answer it, the entry keeps its value and the next one is read at once
+void OpenThermTableReader::skip(OpenThermTable &table, byte index)
+{
+    table.skipped++;
+    table.timestamp = 0;
+    advance(table, index + 1);
+}
+
+void OpenThermTableReader::refresh(OpenThermTable &table)
+{
+    if (table.state != OpenThermTableState::UNSUPPORTED)
+    {
+        table.state = OpenThermTableState::SIZE;
+        table.timestamp = 0;
+    }
+}
+
+bool OpenThermTableReader::isComplete()
+{
+    for (byte i = 0; i < count; i++)
+    {
+        if (tables[i].state == OpenThermTableState::SIZE || tables[i].state == OpenThermTableState::ENTRIES)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+byte OpenThermTableReader::getLength(const OpenThermTable &table)
+{
+    return table.size < table.capacity ? table.size : table.capacity;
+}
+
+static OpenThermTable makeTable(OpenThermMessageID sizeId, OpenThermMessageID valueId, byte *buffer, byte capacity, unsigned long period)
+{
+    OpenThermTable table = {sizeId, valueId, buffer, capacity, period, OpenThermTableState::SIZE, 0, 0, 0, 0, 0, 0};
+    return table;
+}
+
+OpenThermTable OpenThermTableReader::brand(byte *buffer, byte capacity)
+{
+    return makeTable(OpenThermMessageID::Brand, OpenThermMessageID::Brand, buffer, capacity, 0);
+}
+
+OpenThermTable OpenThermTableReader::brandVersion(byte *buffer, byte capacity)
+{
+    return makeTable(OpenThermMessageID::BrandVersion, OpenThermMessageID::BrandVersion, buffer, capacity, 0);
+}
+
+OpenThermTable OpenThermTableReader::brandSerialNumber(byte *buffer, byte capacity)
+{
+    return makeTable(OpenThermMessageID::BrandSerialNumber, OpenThermMessageID::BrandSerialNumber, buffer, capacity, 0);
+}
+
+OpenThermTable OpenThermTableReader::transparentParameters(byte *buffer, byte capacity, unsigned long period)
+{
+    return makeTable(OpenThermMessageID::TSP, OpenThermMessageID::TSPindexTSPvalue, buffer, capacity, period);
+}
+
+OpenThermTable OpenThermTableReader::faultHistory(byte *buffer, byte capacity, unsigned long period)
+{
+    return makeTable(OpenThermMessageID::FHBsize, OpenThermMessageID::FHBindexFHBvalue, buffer, capacity, period);
+}
@@ -0,0 +1,78 @@
+/*
+OpenThermTable.h - Background reading of indexed OpenTherm data
+Copyright 2023, Ihor Melnyk
+
+Reads tables which take one conversation per entry: Brand strings (IDs 93-95),
+transparent slave parameters (TSP) and fault history buffers (FHB) of boiler,
+ventilation and solar storage. Entries are stored in fixed buffers provided by
+the caller.
+Slaves don't report which entries have changed, so a refresh reads the size
+and all entries again.
+*/
+
+#ifndef OpenThermTable_h
+#define OpenThermTable_h
+
+#include "OpenTherm.h"
+
+enum class OpenThermTableState : byte
+{
+    SIZE,     // number of entries is read
+    ENTRIES,  // entries are read
+    COMPLETE,
+    UNSUPPORTED
+};
+
+struct OpenThermTable
+{
+    // For strings like Brand both IDs are the same, size is returned in HB with the first character in LB.
+    // Otherwise size is returned in HB of sizeId (e.g. TSP) and valueId returns index in HB and value in LB.
+    OpenThermMessageID sizeId;
+    OpenThermMessageID valueId;
+    byte *values;
+    byte capacity;
+    unsigned long period; // ms between refreshes, 0 - read once
+
+    // filled by reader
+    OpenThermTableState state;
+    byte size;       // number of entries reported by slave, may be bigger than capacity
+    byte requested;  // next index to request
+    byte fetched;    // number of entries read in the current pass
+    unsigned long timestamp; // ms of completion or failure
+    byte failures;   // failed requests of the current entry
+    byte skipped;    // entries rejected by slave or not answered in the current pass, their values are not updated
+};
+
+class OpenThermTableReader
+{
+public:
+    OpenThermTableReader(OpenTherm &ot, OpenThermTable *tables, byte count);
+    void begin();
+    void process();
+    void refresh(OpenThermTable &table);
+    bool isComplete();
+    // number of entries available in buffer, string tables are not terminated
+    static byte getLength(const OpenThermTable &table);
+
+    static OpenThermTable brand(byte *buffer, byte capacity);
+    static OpenThermTable brandVersion(byte *buffer, byte capacity);
+    static OpenThermTable brandSerialNumber(byte *buffer, byte capacity);
+    static OpenThermTable transparentParameters(byte *buffer, byte capacity, unsigned long period = 0);
+    static OpenThermTable faultHistory(byte *buffer, byte capacity, unsigned long period = 0);
+
+private:
+    OpenTherm &ot;
+    OpenThermTable *tables;
+    const byte count;
+    byte next;          // table checked first, rotated between tables
+    OpenThermTable *pending;
+    byte pendingIndex;
+
+    bool request(OpenThermTable &table, unsigned long now);
+    static void advance(OpenThermTable &table, byte fetched);
+    static void skip(OpenThermTable &table, byte index);
+    void handleResponse(unsigned long response, OpenThermResponseStatus status);
+    static void handleResponse(unsigned long response, OpenThermResponseStatus status, void *context);
+};
+
+#endif // OpenThermTable_h
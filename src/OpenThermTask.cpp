@@ -0,0 +1,194 @@
+/*
+OpenThermTask.cpp - FreeRTOS task driving OpenTherm instance
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermTask.h"
+
+#ifdef INC_FREERTOS_H
+
+// polling period while edges are decoded in process(), see OpenTherm::setDeferredReceive()
+#define OPENTHERM_TASK_DEFERRED_POLL_MS 2
+
+OpenThermTask::OpenThermTask(OpenTherm &ot) :
+    ot(ot),
+    queue(NULL),
+    task(NULL),
+    holding(false)
+{
+}
+
+bool OpenThermTask::begin(UBaseType_t priority, uint32_t stackSize)
+{
+    if (task != NULL)
+    {
+        return false;
+    }
+    if (queue == NULL)
+    {
+        queue = xQueueCreate(OPENTHERM_TASK_QUEUE_SIZE, sizeof(Request));
+        if (queue == NULL)
+        {
+            return false;
+        }
+    }
+    if (xTaskCreate(taskFunction, "OpenTherm", stackSize, this, priority, &task) != pdPASS)
+    {
+        task = NULL;
+        return false;
+    }
+    noInterrupts();
+    ot.notifyTask = task;
+    interrupts();
+    return true;
+}
+
+void OpenThermTask::end()
+{
+    if (task == NULL)
+    {
+        return;
+    }
+    noInterrupts();
+    ot.notifyTask = NULL;
+    interrupts();
+    vTaskDelete(task);
+    task = NULL;
+}
+
+bool OpenThermTask::submit(unsigned long request, OpenThermResponseHandler handler, void *context, TickType_t wait)
+{
+    if (queue == NULL)
+    {
+        return false;
+    }
+    Request entry = {request, handler, context};
+    if (xQueueSend(queue, &entry, wait) != pdTRUE)
+    {
+        return false;
+    }
+    xTaskNotifyGive(task);
+    return true;
+}
+
+OpenThermResult OpenThermTask::sendRequest(unsigned long request)
+{
+    Waiter waiter;
+    waiter.result.response = 0;
+    waiter.result.status = OpenThermResponseStatus::NONE;
+    waiter.task = xTaskGetCurrentTaskHandle();
+    if (!submit(request, wakeWaiter, &waiter, portMAX_DELAY))
+    {
+        return waiter.result;
+    }
+    // request always completes, at the latest with TIMEOUT, so waiter can stay on the stack
+    while (waiter.task != NULL)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    return waiter.result;
+}
+
+TaskHandle_t OpenThermTask::getTaskHandle()
+{
+    return task;
+}
+
+void OpenThermTask::wakeWaiter(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    Waiter *waiter = static_cast<Waiter *>(context);
+    TaskHandle_t waitingTask = waiter->task;
+    waiter->result.response = response;
+    waiter->result.status = status;
+    waiter->task = NULL;
+    xTaskNotifyGive(waitingTask);
+}
+
+void OpenThermTask::taskFunction(void *parameter)
+{
+    static_cast<OpenThermTask *>(parameter)->run();
+}
+
+void OpenThermTask::run()
+{
+    for (;;)
+    {
+        enqueueRequests();
+        ot.process();
+        ulTaskNotifyTake(pdTRUE, getWaitTicks());
+    }
+}
+
+void OpenThermTask::enqueueRequests()
+{
+    while (ot.getQueueDepth() < OPENTHERM_REQUEST_QUEUE_SIZE)
+    {
+        if (!holding && xQueueReceive(queue, &held, 0) != pdTRUE)
+        {
+            return;
+        }
+        holding = !ot.enqueueRequest(held.request, held.handler, held.context);
+        if (holding)
+        {
+            return;
+        }
+    }
+}
+
+// Time until process() has something to do, frame completion is reported by the interrupt handler.
+TickType_t OpenThermTask::getWaitTicks()
+{
+    noInterrupts();
+    const OpenThermStatus st = ot.status;
+    const unsigned long ts = ot.responseTimestamp;
+    interrupts();
+
+    unsigned long period;
+    switch (st)
+    {
+    case OpenThermStatus::NOT_INITIALIZED:
+        return portMAX_DELAY;
+    case OpenThermStatus::READY:
+        if (ot.getQueueDepth() > 0 || holding || uxQueueMessagesWaiting(queue) > 0)
+        {
+            // a retried request waits for its backoff, rounded up so a short one doesn't spin
+            const unsigned long backoff = ot.getQueueDelay();
+            return backoff > 0 ? pdMS_TO_TICKS(backoff) + 1 : 0;
+        }
+#if OPENTHERM_DISCOVERY
+        if (ot.isDiscovering())
+        {
+            // next probe is sent by process() once the bus stays idle
+            return pdMS_TO_TICKS(ot.timing.masterDelay / 1000 + 1) + 1;
+        }
+#endif
+        // slave is woken by the interrupt handler when a request starts, in deferred receive
+        // mode on its first edge, then it polls the edge buffer
+        return portMAX_DELAY;
+    case OpenThermStatus::RESPONSE_READY:
+    case OpenThermStatus::RESPONSE_INVALID:
+        return 0;
+    case OpenThermStatus::DELAY:
+        period = ot.isSlave ? ot.timing.slaveDelay : ot.timing.masterDelay;
+        break;
+    default:
+#if OPENTHERM_EDGE_BUFFER_SIZE > 0
+        if (ot.deferredReceive)
+        {
+            return pdMS_TO_TICKS(OPENTHERM_TASK_DEFERRED_POLL_MS) + 1;
+        }
+#endif
+        period = ot.getResponseTimeout();
+        break;
+    }
+
+    const unsigned long elapsed = openThermMicros() - ts;
+    if (elapsed >= period)
+    {
+        return 0;
+    }
+    // rounded up, so the deadline has passed when the task wakes up
+    return pdMS_TO_TICKS((period - elapsed) / 1000 + 1) + 1;
+}
+
+#endif // INC_FREERTOS_H
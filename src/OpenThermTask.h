@@ -0,0 +1,60 @@
+/*
+OpenThermTask.h - FreeRTOS task driving OpenTherm instance
+Copyright 2023, Ihor Melnyk
+
+Task calls OpenTherm::process() only when there is something to do: it sleeps
+until the interrupt handler reports a complete frame, a submitted request
+arrives or the next timeout/delay expires. Other tasks send requests through
+a FreeRTOS queue, OpenTherm instance must not be used by them directly.
+*/
+
+#ifndef OpenThermTask_h
+#define OpenThermTask_h
+
+#include "OpenTherm.h"
+#include "OpenThermFuture.h"
+
+#ifdef INC_FREERTOS_H
+
+class OpenThermTask
+{
+public:
+    OpenThermTask(OpenTherm &ot);
+    // starts the task, OpenTherm::begin() must be called before
+    bool begin(UBaseType_t priority = 5, uint32_t stackSize = 4096);
+    void end();
+    // handler is called in the context of the driver task
+    bool submit(unsigned long request, OpenThermResponseHandler handler = NULL, void *context = NULL, TickType_t wait = 0);
+    // blocks calling task until the response is received, uses its task notification
+    OpenThermResult sendRequest(unsigned long request);
+    TaskHandle_t getTaskHandle();
+
+private:
+    struct Request
+    {
+        unsigned long request;
+        OpenThermResponseHandler handler;
+        void *context;
+    };
+    struct Waiter
+    {
+        OpenThermResult result;
+        TaskHandle_t task;
+    };
+
+    OpenTherm &ot;
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    Request held;       // request taken from queue while OpenTherm queue was full
+    bool holding;
+
+    void run();
+    void enqueueRequests();
+    TickType_t getWaitTicks();
+    static void taskFunction(void *parameter);
+    static void wakeWaiter(unsigned long response, OpenThermResponseStatus status, void *context);
+};
+
+#endif // INC_FREERTOS_H
+
+#endif // OpenThermTask_h
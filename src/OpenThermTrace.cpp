@@ -0,0 +1,290 @@
+/*
+OpenThermTrace.cpp - Compact binary bus trace capture and replay
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermTrace.h"
+
+OpenThermTrace::OpenThermTrace(uint8_t *buffer, size_t size) :
+    buffer(buffer),
+    size(size),
+    head(0),
+    tail(0),
+    lastTimestamp(0),
+    started(false),
+    dropped(0)
+{
+}
+
+void OpenThermTrace::record(OpenThermTraceDirection direction, unsigned long frame, OpenThermResponseStatus status, unsigned long timestamp)
+{
+    OpenThermTraceRecord record;
+    record.direction = direction;
+    record.status = status;
+    record.frame = frame;
+    record.delta = started ? (uint32_t)(timestamp - lastTimestamp) : 0;
+    lastTimestamp = timestamp;
+    started = true;
+
+    uint8_t data[MAX_RECORD_SIZE];
+    byte length = encode(data, record);
+
+    // oldest records are dropped to make room, one byte is kept free to tell full buffer from empty
+    while (size - 1 - available() < length)
+    {
+        if (available() == 0)
+        {
+            return;
+        }
+        tail = (tail + recordSize(0)) % size;
+        dropped++;
+        if (available() > 0)
+        {
+            rebase();
+        }
+        else
+        {
+            // the new record becomes the oldest one
+            record.delta = 0;
+            length = encode(data, record);
+        }
+    }
+    for (byte i = 0; i < length; i++)
+    {
+        buffer[(head + i) % size] = data[i];
+    }
+    head = (head + length) % size;
+}
+
+bool OpenThermTrace::read(OpenThermTraceRecord &record)
+{
+    if (available() == 0)
+    {
+        return false;
+    }
+    uint8_t data[MAX_RECORD_SIZE];
+    const byte length = recordSize(0);
+    for (byte i = 0; i < length; i++)
+    {
+        data[i] = peek(i);
+    }
+    tail = (tail + length) % size;
+    return decode(data, length, record) > 0;
+}
+
+size_t OpenThermTrace::available()
+{
+    return (head + size - tail) % size;
+}
+
+size_t OpenThermTrace::readBytes(uint8_t *data, size_t count)
+{
+    size_t n = 0;
+    while (n < count && available() > 0)
+    {
+        data[n++] = buffer[tail];
+        tail = (tail + 1) % size;
+    }
+    return n;
+}
+
+// Writes as much as output accepts without blocking, returns number of bytes written
+size_t OpenThermTrace::flush(Print &output)
+{
+    size_t n = 0;
+    int space = output.availableForWrite();
+    if (space <= 0)
+    {
+        // Print reports no free space unless the stream overrides availableForWrite(), it can't
+        // be told from a full stream, so both get a bounded chunk
+        space = OPENTHERM_FLUSH_CHUNK;
+    }
+    while (space > 0 && available() > 0)
+    {
+        const size_t chunk = head >= tail ? head - tail : size - tail;
+        const size_t count = chunk < (size_t)space ? chunk : (size_t)space;
+        const size_t written = output.write(buffer + tail, count);
+        tail = (tail + written) % size;
+        n += written;
+        if (written < count)
+        {
+            break;
+        }
+        space -= written;
+    }
+    return n;
+}
+
+void OpenThermTrace::clear()
+{
+    tail = head;
+    started = false;
+}
+
+unsigned long OpenThermTrace::getDropped()
+{
+    return dropped;
+}
+
+byte OpenThermTrace::peek(size_t offset)
+{
+    return buffer[(tail + offset) % size];
+}
+
+byte OpenThermTrace::recordSize(size_t offset)
+{
+    byte length = 1;
+    while (peek(offset + length) & 0x80)
+    {
+        length++;
+    }
+    return length + 1 + 4;
+}
+
+// The oldest record has no previous one, its delta is set to 0. The shorter record
+// is written so that it ends where the old one did.
+void OpenThermTrace::rebase()
+{
+    const byte deltaLength = recordSize(0) - 5;
+    const byte header = peek(0);
+    tail = (tail + deltaLength - 1) % size;
+    buffer[tail] = header;
+    buffer[(tail + 1) % size] = 0;
+}
+
+byte OpenThermTrace::encode(uint8_t *data, const OpenThermTraceRecord &record)
+{
+    byte length = 0;
+    data[length++] = ((byte)record.direction << 4) | ((byte)record.status & 0x0F);
+    // at most 5 bytes, deltas longer than 32 bits are truncated
+    uint32_t delta = record.delta;
+    while (delta >= 0x80)
+    {
+        data[length++] = (delta & 0x7F) | 0x80;
+        delta >>= 7;
+    }
+    data[length++] = delta;
+    for (byte i = 0; i < 4; i++)
+    {
+        data[length++] = (record.frame >> (8 * i)) & 0xFF;
+    }
+    return length;
+}
+
+// Returns record length or 0 if data is too short
+byte OpenThermTrace::decode(const uint8_t *data, size_t size, OpenThermTraceRecord &record)
+{
+    if (size < 6)
+    {
+        return 0;
+    }
+    record.direction = (OpenThermTraceDirection)(data[0] >> 4);
+    record.status = (OpenThermResponseStatus)(data[0] & 0x0F);
+    record.delta = 0;
+    byte length = 1;
+    byte shift = 0;
+    while (true)
+    {
+        if (length >= size || length >= MAX_RECORD_SIZE - 4)
+        {
+            return 0;
+        }
+        const byte b = data[length++];
+        record.delta |= (unsigned long)(b & 0x7F) << shift;
+        shift += 7;
+        if (!(b & 0x80))
+        {
+            break;
+        }
+    }
+    if ((size_t)length + 4 > size)
+    {
+        return 0;
+    }
+    record.frame = 0;
+    for (byte i = 0; i < 4; i++)
+    {
+        record.frame |= (unsigned long)data[length++] << (8 * i);
+    }
+    return length;
+}
+
+#if defined(OPENTHERM_HOST)
+OpenThermReplay::OpenThermReplay(OpenTherm &ot) :
+    ot(ot),
+    timestamp(0),
+    started(false)
+{
+}
+
+void OpenThermReplay::replay(const uint8_t *data, size_t size)
+{
+    OpenThermTraceRecord record;
+    size_t offset = 0;
+    byte length;
+    while ((length = OpenThermTrace::decode(data + offset, size - offset, record)) > 0)
+    {
+        offset += length;
+        replay(record);
+    }
+}
+
+void OpenThermReplay::replay(const OpenThermTraceRecord &record)
+{
+    // record time on the virtual clock, replay never goes back in time
+    timestamp = started ? timestamp + record.delta : micros();
+    started = true;
+
+    if (record.direction == OpenThermTraceDirection::SENT)
+    {
+        runUntil(timestamp);
+        waitReady();
+        ot.sendRequestAsync(record.frame);
+        return;
+    }
+
+    if (record.status == OpenThermResponseStatus::TIMEOUT)
+    {
+        runUntil(timestamp);
+        return;
+    }
+
+    // received record is stamped at the end of the frame, 34 bits of 1ms each
+    const unsigned long frameTime = 34000;
+    runUntil(timestamp - frameTime);
+    int level = LOW;
+    for (byte i = 0; i < 68; i++)
+    {
+        const byte bit = i / 2;
+        const bool high = (bit == 0 || bit == 33) ? true : bitRead(record.frame, 32 - bit);
+        const int halfLevel = (high == ((i & 1) == 0)) ? HIGH : LOW;
+        if (halfLevel != level)
+        {
+            level = halfLevel;
+            ot.handleEdge(micros(), level);
+        }
+        OpenThermHost::advance(500);
+    }
+    ot.process();
+}
+
+void OpenThermReplay::runUntil(unsigned long time)
+{
+    const unsigned long step = 1000;
+    while ((long)(time - micros()) > 0)
+    {
+        const unsigned long left = time - micros();
+        OpenThermHost::advance(left < step ? left : step);
+        ot.process();
+    }
+}
+
+void OpenThermReplay::waitReady()
+{
+    // recorded delays can be shorter than post-response delay of this instance
+    for (int i = 0; i < 2000 && !ot.isReady(); i++)
+    {
+        runUntil(micros() + 1000);
+    }
+}
+#endif
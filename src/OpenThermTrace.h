@@ -0,0 +1,84 @@
+/*
+OpenThermTrace.h - Compact binary bus trace capture and replay
+Copyright 2023, Ihor Melnyk
+
+Record format, 6..10 bytes:
+HEADER   DELTA-TIMESTAMP        FRAME
+DDDDSSSS varint, us since last  4 bytes, little endian
+D - direction, S - response status
+Deltas are 32 bit, a record whose predecessor was dropped has delta 0.
+*/
+
+#ifndef OpenThermTrace_h
+#define OpenThermTrace_h
+
+#include "OpenTherm.h"
+
+enum class OpenThermTraceDirection : byte
+{
+    SENT,
+    RECEIVED
+};
+
+struct OpenThermTraceRecord
+{
+    OpenThermTraceDirection direction;
+    OpenThermResponseStatus status;
+    unsigned long frame;
+    unsigned long delta; // us since previous record, 0 for the first one and after a dropped one
+};
+
+class OpenThermTrace
+{
+public:
+    static const byte MAX_RECORD_SIZE = 10;
+
+    OpenThermTrace(uint8_t *buffer, size_t size);
+    void record(OpenThermTraceDirection direction, unsigned long frame, OpenThermResponseStatus status, unsigned long timestamp);
+    bool read(OpenThermTraceRecord &record);
+    size_t available();
+    size_t readBytes(uint8_t *data, size_t size);
+    // writes as much as output accepts, OPENTHERM_FLUSH_CHUNK bytes to a stream which doesn't
+    // report its free space
+    size_t flush(Print &output);
+    void clear();
+    unsigned long getDropped();
+
+    static byte encode(uint8_t *data, const OpenThermTraceRecord &record);
+    static byte decode(const uint8_t *data, size_t size, OpenThermTraceRecord &record);
+
+private:
+    uint8_t *buffer;
+    const size_t size;
+    volatile size_t head;
+    volatile size_t tail;
+    unsigned long lastTimestamp;
+    bool started;
+    unsigned long dropped;
+
+    byte peek(size_t offset);
+    byte recordSize(size_t offset);
+    void rebase();
+};
+
+#if defined(OPENTHERM_HOST)
+// Feeds recorded frames to OpenTherm instance, driving virtual clock of the host build.
+// Sent records are sent again, received records are converted to line edges for the decoder.
+class OpenThermReplay
+{
+public:
+    OpenThermReplay(OpenTherm &ot);
+    void replay(const uint8_t *data, size_t size);
+    void replay(const OpenThermTraceRecord &record);
+
+private:
+    OpenTherm &ot;
+    unsigned long timestamp;
+    bool started;
+
+    void runUntil(unsigned long time);
+    void waitReady();
+};
+#endif
+
+#endif // OpenThermTrace_h
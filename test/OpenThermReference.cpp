@@ -0,0 +1,69 @@
+/*
+OpenThermReference.cpp - Straightforward frame helpers for tests and benchmarks
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermReference.h"
+
+namespace OpenThermReference
+{
+
+bool parity(unsigned long frame) // odd parity
+{
+    byte p = 0;
+    while (frame > 0)
+    {
+        if (frame & 1)
+            p++;
+        frame = frame >> 1;
+    }
+    return (p & 1);
+}
+
+unsigned long buildRequest(OpenThermMessageType type, OpenThermMessageID id, unsigned int data)
+{
+    unsigned long request = data;
+    if (type == OpenThermMessageType::WRITE_DATA)
+    {
+        request |= 1ul << 28;
+    }
+    request |= ((unsigned long)id) << 16;
+    if (parity(request))
+        request |= (1ul << 31);
+    return request;
+}
+
+unsigned long buildResponse(OpenThermMessageType type, OpenThermMessageID id, unsigned int data)
+{
+    unsigned long response = data;
+    response |= ((unsigned long)type) << 28;
+    response |= ((unsigned long)id) << 16;
+    if (parity(response))
+        response |= (1ul << 31);
+    return response;
+}
+
+bool isValidResponse(unsigned long response)
+{
+    if (parity(response))
+        return false;
+    byte msgType = (response >> 28) & 7;
+    return msgType == (byte)OpenThermMessageType::READ_ACK || msgType == (byte)OpenThermMessageType::WRITE_ACK;
+}
+
+bool isValidRequest(unsigned long request)
+{
+    if (parity(request))
+        return false;
+    byte msgType = (request >> 28) & 7;
+    return msgType == (byte)OpenThermMessageType::READ_DATA || msgType == (byte)OpenThermMessageType::WRITE_DATA;
+}
+
+float getFloat(const unsigned long response)
+{
+    const uint16_t u88 = response & 0xFFFF;
+    const float f = (u88 & 0x8000) ? -(0x10000L - u88) / 256.0f : u88 / 256.0f;
+    return f;
+}
+
+}
@@ -0,0 +1,25 @@
+/*
+OpenThermReference.h - Straightforward frame helpers for tests and benchmarks
+Copyright 2023, Ihor Melnyk
+
+Bit by bit implementations of OpenTherm frame helpers as they were before
+parity and validation were optimized. Optimized helpers must give the same
+results, see test_frame.cpp and bench_frame.cpp.
+*/
+
+#ifndef OpenThermReference_h
+#define OpenThermReference_h
+
+#include "OpenTherm.h"
+
+namespace OpenThermReference
+{
+    bool parity(unsigned long frame);
+    unsigned long buildRequest(OpenThermMessageType type, OpenThermMessageID id, unsigned int data);
+    unsigned long buildResponse(OpenThermMessageType type, OpenThermMessageID id, unsigned int data);
+    bool isValidRequest(unsigned long request);
+    bool isValidResponse(unsigned long response);
+    float getFloat(const unsigned long response);
+}
+
+#endif // OpenThermReference_h
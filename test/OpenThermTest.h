@@ -0,0 +1,173 @@
+/*
+OpenThermTest.h - Minimal test helpers for host tests of OpenTherm Library
+Copyright 2023, Ihor Melnyk
+*/
+
+#ifndef OpenThermTest_h
+#define OpenThermTest_h
+
+#include <stdio.h>
+#include "OpenTherm.h"
+#include "OpenThermSlave.h"
+
+static int openThermTestFailures = 0;
+
+#define CHECK(condition)                                                           \
+    do                                                                             \
+    {                                                                              \
+        if (!(condition))                                                          \
+        {                                                                          \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);   \
+            openThermTestFailures++;                                               \
+        }                                                                          \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual)                                              \
+    do                                                                             \
+    {                                                                              \
+        const unsigned long e = (unsigned long)(expected);                         \
+        const unsigned long a = (unsigned long)(actual);                           \
+        if (e != a)                                                                \
+        {                                                                          \
+            printf("%s:%d: CHECK_EQUAL(%s, %s) failed: 0x%lx != 0x%lx\n",          \
+                   __FILE__, __LINE__, #expected, #actual, e, a);                  \
+            openThermTestFailures++;                                               \
+        }                                                                          \
+    } while (0)
+
+// returns the exit code of a test
+inline int testResult()
+{
+    if (openThermTestFailures > 0)
+    {
+        printf("%d check(s) failed\n", openThermTestFailures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
+
+// starts a test with fresh pins and clock
+inline void testReset()
+{
+    OpenThermHost::reset();
+    OpenThermTestPin::unlinkAll();
+}
+
+// Boiler emulated by OpenThermSlave on its own slave instance
+class OpenThermTestBoiler : public OpenThermSlave
+{
+public:
+    OpenTherm slave;
+
+    OpenThermTestBoiler(int inPin, int outPin) :
+        OpenThermSlave(slave),
+        slave(inPin, outPin, true),
+        inPin(inPin),
+        outPin(outPin),
+        masterInPin(-1)
+    {
+    }
+
+    // links the boiler to the pins of a master
+    void connect(int masterInPin, int masterOutPin)
+    {
+        this->masterInPin = masterInPin;
+        OpenThermTestPin::link(masterOutPin, inPin);
+        OpenThermTestPin::link(outPin, masterInPin);
+    }
+
+    // responses are lost until the boiler is connected again
+    void disconnect()
+    {
+        OpenThermTestPin::link(outPin, -1);
+    }
+
+    void reconnect()
+    {
+        OpenThermTestPin::link(outPin, masterInPin);
+    }
+
+    void begin()
+    {
+        slave.begin();
+        OpenThermSlave::begin();
+    }
+
+private:
+    const int inPin;
+    const int outPin;
+    int masterInPin;
+};
+
+// Output which keeps what is written, like many Arduino streams it doesn't report free space
+class OpenThermTestOutput : public Print
+{
+public:
+    char text[256];
+    size_t length;
+
+    OpenThermTestOutput() : length(0)
+    {
+        text[0] = 0;
+    }
+
+    size_t write(uint8_t c)
+    {
+        if (length + 1 >= sizeof(text))
+        {
+            return 0;
+        }
+        text[length++] = c;
+        text[length] = 0;
+        return 1;
+    }
+};
+
+// Master connected to a boiler through loopback pins
+class OpenThermLoopback
+{
+public:
+    OpenTherm master;
+    OpenThermTestBoiler boiler;
+    void (*tick)(void); // called after every clock step, e.g. by a fake timer
+
+    OpenThermLoopback(int masterInPin = 2, int masterOutPin = 3, int slaveInPin = 4, int slaveOutPin = 5) :
+        master(masterInPin, masterOutPin),
+        boiler(slaveInPin, slaveOutPin),
+        tick(NULL),
+        masterInPin(masterInPin),
+        masterOutPin(masterOutPin)
+    {
+    }
+
+    // starts with fresh pins and clock
+    void begin()
+    {
+        testReset();
+        boiler.connect(masterInPin, masterOutPin);
+        master.begin();
+        boiler.begin();
+    }
+
+    // advances the clock in steps, both sides are processed after each of them
+    void run(unsigned long us, unsigned long step = 100)
+    {
+        for (unsigned long i = 0; i < us; i += step)
+        {
+            OpenThermHost::advance(step);
+            if (tick != NULL)
+            {
+                tick();
+            }
+            master.process();
+            boiler.process();
+        }
+    }
+
+private:
+    const int masterInPin;
+    const int masterOutPin;
+};
+
+#endif // OpenThermTest_h
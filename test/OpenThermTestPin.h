@@ -0,0 +1,58 @@
+/*
+OpenThermTestPin.h - Loopback pins for host tests of OpenTherm Library
+Copyright 2023, Ihor Melnyk
+
+Included before the library with OPENTHERM_PIN_CLASS=OpenThermTestPin.
+Writing an output pin drives the linked input pin inverted, the same way an
+adapter drives the bus, so a master and a slave on simulated pins talk to
+each other.
+*/
+
+#ifndef OpenThermTestPin_h
+#define OpenThermTestPin_h
+
+#include "OpenThermHost.h"
+
+class OpenThermTestPin
+{
+public:
+    // output pin drives input pin, -1 removes the link
+    static void link(int output, int input)
+    {
+        links()[output] = input + 1;
+    }
+
+    static void unlinkAll()
+    {
+        memset(links(), 0, sizeof(int) * OpenThermHost::PINS);
+    }
+
+    void begin(int pin)
+    {
+        this->pin = pin;
+    }
+    inline int read() const
+    {
+        return digitalRead(pin);
+    }
+    inline void write(int value) const
+    {
+        digitalWrite(pin, value);
+        const int input = links()[pin] - 1;
+        if (input >= 0)
+        {
+            OpenThermHost::setPin(input, value == HIGH ? LOW : HIGH);
+        }
+    }
+
+private:
+    int pin;
+
+    static int *links()
+    {
+        static int instance[OpenThermHost::PINS];
+        return instance;
+    }
+};
+
+#endif // OpenThermTestPin_h
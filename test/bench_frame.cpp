@@ -0,0 +1,80 @@
+/*
+bench_frame.cpp - Time per frame of optimized and reference frame helpers
+Copyright 2023, Ihor Melnyk
+
+Not run by ctest: cmake --build build --target bench_frame && build/test/bench_frame
+*/
+
+#include <chrono>
+#include <stdio.h>
+#include "OpenTherm.h"
+#include "OpenThermReference.h"
+
+static const unsigned int FRAMES = 4096;
+static const unsigned int ROUNDS = 2000;
+static unsigned long frames[FRAMES];
+static volatile unsigned long sink;
+
+template <typename Function>
+static double measure(Function function)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long accumulator = 0;
+    for (unsigned int round = 0; round < ROUNDS; round++)
+    {
+        for (unsigned int i = 0; i < FRAMES; i++)
+        {
+            accumulator += function(frames[i]);
+        }
+    }
+    sink = accumulator;
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ((double)FRAMES * ROUNDS);
+}
+
+static void report(const char *name, double optimized, double reference)
+{
+    printf("%-18s %8.2f ns %8.2f ns %6.1fx\n", name, optimized, reference, reference / optimized);
+}
+
+int main()
+{
+    unsigned long state = 0x2545F4914F6CDD1Dul;
+    for (unsigned int i = 0; i < FRAMES; i++)
+    {
+        state = state * 6364136223846793005ul + 1442695040888963407ul;
+        frames[i] = (state >> 16) & 0xFFFFFFFFul;
+    }
+
+    printf("%-18s %11s %11s %7s\n", "ns/frame", "optimized", "reference", "speedup");
+    report("parity",
+           measure([](unsigned long frame) { return (unsigned long)OpenTherm::parity(frame); }),
+           measure([](unsigned long frame) { return (unsigned long)OpenThermReference::parity(frame); }));
+    report("isValidResponse",
+           measure([](unsigned long frame) { return (unsigned long)OpenTherm::isValidResponse(frame); }),
+           measure([](unsigned long frame) { return (unsigned long)OpenThermReference::isValidResponse(frame); }));
+    report("isValidRequest",
+           measure([](unsigned long frame) { return (unsigned long)OpenTherm::isValidRequest(frame); }),
+           measure([](unsigned long frame) { return (unsigned long)OpenThermReference::isValidRequest(frame); }));
+    report("getFloat",
+           measure([](unsigned long frame) { return (unsigned long)(OpenTherm::getFloat(frame) * 256); }),
+           measure([](unsigned long frame) { return (unsigned long)(OpenThermReference::getFloat(frame) * 256); }));
+    report("buildResponse",
+           measure([](unsigned long frame) { return OpenTherm::buildResponse(OpenThermMessageType::READ_ACK, (OpenThermMessageID)(frame >> 16 & 0xFF), frame & 0xFFFF); }),
+           measure([](unsigned long frame) { return OpenThermReference::buildResponse(OpenThermMessageType::READ_ACK, (OpenThermMessageID)(frame >> 16 & 0xFF), frame & 0xFFFF); }));
+
+    // batch validation against a loop over the reference
+    bool valid[FRAMES];
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long count = 0;
+    for (unsigned int round = 0; round < ROUNDS; round++)
+    {
+        count += OpenTherm::validateResponses(frames, FRAMES, valid);
+    }
+    sink = count;
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    report("validateResponses",
+           elapsed.count() / ((double)FRAMES * ROUNDS),
+           measure([](unsigned long frame) { return (unsigned long)OpenThermReference::isValidResponse(frame); }));
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+test_bus.cpp - Several buses driven by one controller, see OpenThermBus
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermBus.h"
+#include "OpenThermTest.h"
+
+OpenTherm ot1(2, 4), ot2(3, 5);
+OpenTherm *buses[] = {&ot1, &ot2};
+OpenThermBus bus(buses, 2);
+
+OpenThermTestBoiler boiler1(10, 11), boiler2(12, 13);
+
+static void handleInterrupt()
+{
+    bus.handleInterrupt();
+}
+
+// fake 500us timers, one shared by the buses and one by the slaves
+struct Timer
+{
+    bool running;
+    unsigned long started;
+};
+static Timer busTimer = {false, 0};
+static Timer slaveTimer = {false, 0};
+
+static void startBusTimer()
+{
+    if (!busTimer.running)
+    {
+        busTimer.running = true;
+        busTimer.started = micros();
+    }
+}
+
+static void stopBusTimer()
+{
+    busTimer.running = false;
+}
+
+static void startSlaveTimer()
+{
+    if (!slaveTimer.running)
+    {
+        slaveTimer.running = true;
+        slaveTimer.started = micros();
+    }
+}
+
+static void stopSlaveTimer()
+{
+    // kept running, the other slave may be sending
+}
+
+static bool isTick(const Timer &timer)
+{
+    return timer.running && (micros() - timer.started) % 500 == 0;
+}
+
+static void run(unsigned long us)
+{
+    for (unsigned long i = 0; i < us; i += 10)
+    {
+        OpenThermHost::advance(10);
+        if (isTick(busTimer))
+        {
+            bus.handleTimerInterrupt();
+        }
+        if (isTick(slaveTimer))
+        {
+            boiler1.slave.handleTimerInterrupt();
+            boiler2.slave.handleTimerInterrupt();
+        }
+        bus.process();
+        boiler1.process();
+        boiler2.process();
+    }
+}
+
+static unsigned long responses[2];
+static unsigned long responseTimes[2];
+
+static void handleResponse(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    const int index = *static_cast<int *>(context);
+    responses[index] = status == OpenThermResponseStatus::SUCCESS ? response : 0;
+    responseTimes[index] = micros();
+}
+
+int main()
+{
+    testReset();
+    boiler1.connect(2, 4);
+    boiler2.connect(3, 5);
+    boiler1.begin();
+    boiler2.begin();
+    boiler1.slave.setTransmitTimer(startSlaveTimer, stopSlaveTimer);
+    boiler2.slave.setTransmitTimer(startSlaveTimer, stopSlaveTimer);
+    boiler1.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    boiler2.setFloat(OpenThermMessageID::Tboiler, 60);
+
+    // one activation delay for all buses
+    const unsigned long started = micros();
+    bus.begin(handleInterrupt);
+    CHECK_EQUAL(1000000, micros() - started);
+    CHECK(ot1.isReady());
+    CHECK(ot2.isReady());
+    bus.setTransmitTimer(startBusTimer, stopBusTimer);
+
+    // conversations on both buses overlap
+    static int indexes[] = {0, 1};
+    const unsigned long sent = micros();
+    const unsigned long request = OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0);
+    CHECK(bus.get(0).enqueueRequest(request, handleResponse, &indexes[0]));
+    CHECK(bus.get(1).enqueueRequest(request, handleResponse, &indexes[1]));
+    run(300000);
+    CHECK_EQUAL(0x2D80, responses[0] & 0xFFFF);
+    CHECK_EQUAL(0x3C00, responses[1] & 0xFFFF);
+    // request, slave latency and response, much less than two conversations
+    CHECK(responseTimes[0] - sent < 100000);
+    CHECK(responseTimes[1] - sent < 100000);
+    CHECK(!busTimer.running);
+    return testResult();
+}
@@ -0,0 +1,80 @@
+/*
+test_cache.cpp - Response cache, see OpenTherm::getCachedResponse
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+
+static void read(OpenThermMessageID id, uint16_t data)
+{
+    CHECK(master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, id, data)));
+    loopback.run(500000);
+}
+
+static void testPlainReadIsCached()
+{
+    read(OpenThermMessageID::Tboiler, 0);
+    unsigned long response = 0;
+    CHECK(master.getCachedResponse(OpenThermMessageID::Tboiler, response, 5000));
+    CHECK_EQUAL(OpenTherm::buildResponse(OpenThermMessageType::READ_ACK, OpenThermMessageID::Tboiler, 0x2D80), response);
+}
+
+static void testEntryExpires()
+{
+    read(OpenThermMessageID::Tboiler, 0);
+    unsigned long response = 0;
+    CHECK(master.getCachedResponse(OpenThermMessageID::Tboiler, response, 1000));
+
+    // readData is answered from the cache without a conversation while the entry is fresh
+    master.setCacheMaxAge(1000);
+    const unsigned long responses = boiler.getResponseCount();
+    response = 0;
+    CHECK(master.readData(OpenThermMessageID::Tboiler, response) == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(0x2D80, response & 0xFFFF);
+    CHECK_EQUAL(responses, boiler.getResponseCount());
+    master.setCacheMaxAge(0);
+
+    // answered early in the 500ms read, so the entry is more than a second old
+    loopback.run(1000000);
+    CHECK(!master.getCachedResponse(OpenThermMessageID::Tboiler, response, 1000));
+    CHECK(master.getCachedResponse(OpenThermMessageID::Tboiler, response, 2000));
+
+    // a new answer refreshes the entry
+    read(OpenThermMessageID::Tboiler, 0);
+    CHECK(master.getCachedResponse(OpenThermMessageID::Tboiler, response, 1000));
+}
+
+// answers of these IDs depend on the data of the request
+static void testRequestDataDependentIdsAreNotCached()
+{
+    CHECK(!OpenTherm::isCacheable(OpenThermMessageID::Status));
+    CHECK(!OpenTherm::isCacheable(OpenThermMessageID::TSPindexTSPvalue));
+    CHECK(!OpenTherm::isCacheable(OpenThermMessageID::FHBindexFHBvalueSolarStorage));
+    CHECK(!OpenTherm::isCacheable(OpenThermMessageID::Brand));
+    CHECK(OpenTherm::isCacheable(OpenThermMessageID::Tboiler));
+
+    read(OpenThermMessageID::Status, 0x0300);
+    read(OpenThermMessageID::TSPindexTSPvalue, 0x0100);
+    CHECK(OpenTherm::getMessageType(master.getLastResponse()) == OpenThermMessageType::READ_ACK);
+    unsigned long response = 0;
+    CHECK(!master.getCachedResponse(OpenThermMessageID::Status, response, 5000));
+    CHECK(!master.getCachedResponse(OpenThermMessageID::TSPindexTSPvalue, response, 5000));
+}
+
+int main()
+{
+    loopback.begin();
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    boiler.setValue(OpenThermMessageID::Status, 0x000A);
+    boiler.setValue(OpenThermMessageID::TSPindexTSPvalue, 0x0132);
+
+    testPlainReadIsCached();
+    testEntryExpires();
+    testRequestDataDependentIdsAreNotCached();
+    return testResult();
+}
@@ -0,0 +1,67 @@
+/*
+test_centi.cpp - Integer temperature helpers, see OpenTherm::f88ToCenti and OpenTherm::centiToF88
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTest.h"
+
+// rounded to the nearest hundredth, halves up, arithmetic shift keeps negative values right
+static void testF88ToCenti()
+{
+    CHECK_EQUAL(2550, OpenTherm::f88ToCenti(0x1980));
+    CHECK_EQUAL(0, OpenTherm::f88ToCenti(-1));
+    CHECK_EQUAL(-1, OpenTherm::f88ToCenti(-2));
+    CHECK_EQUAL(-50, OpenTherm::f88ToCenti(-128));
+    CHECK_EQUAL(-150, OpenTherm::f88ToCenti(-384));
+    CHECK_EQUAL(-550, OpenTherm::f88ToCenti(-1408));
+    // 12.5 and -12.5 hundredths
+    CHECK_EQUAL(13, OpenTherm::f88ToCenti(32));
+    CHECK_EQUAL(-12, OpenTherm::f88ToCenti(-32));
+    // ends of the f8.8 range, 127.996 rounds to 128.00
+    CHECK_EQUAL(12800, OpenTherm::f88ToCenti(INT16_MAX));
+    CHECK_EQUAL(-12800, OpenTherm::f88ToCenti(INT16_MIN));
+
+    const unsigned long response = OpenTherm::buildResponse(OpenThermMessageType::READ_ACK, OpenThermMessageID::Toutside, (uint16_t)-1408);
+    CHECK_EQUAL(-550, OpenTherm::getCenti(response));
+    CHECK(OpenTherm::getFloat(response) == -5.5f);
+}
+
+// truncated toward zero like the float conversion, saturated to the f8.8 range
+static void testCentiToF88()
+{
+    CHECK_EQUAL(0x1980, OpenTherm::centiToF88(2550));
+    CHECK_EQUAL(-1408, OpenTherm::centiToF88(-550));
+    CHECK_EQUAL(2, OpenTherm::centiToF88(1));
+    CHECK_EQUAL(-2, OpenTherm::centiToF88(-1));
+    CHECK_EQUAL(INT16_MIN, OpenTherm::centiToF88(-12800));
+    CHECK_EQUAL(INT16_MAX, OpenTherm::centiToF88(12800));
+    CHECK_EQUAL(INT16_MIN, OpenTherm::centiToF88(-12801));
+    CHECK_EQUAL(INT16_MAX, OpenTherm::centiToF88(INT16_MAX));
+    CHECK_EQUAL(INT16_MIN, OpenTherm::centiToF88(INT16_MIN));
+
+    CHECK_EQUAL(0, OpenTherm::temperatureToDataCenti(-550));
+    CHECK_EQUAL(0x6400, OpenTherm::temperatureToDataCenti(12000));
+}
+
+// every hundredth in the f8.8 range survives the conversion and back
+static void testRoundTrip()
+{
+    int failures = 0;
+    for (long centi = -12800; centi <= 12800; centi++)
+    {
+        if (OpenTherm::f88ToCenti(OpenTherm::centiToF88((int16_t)centi)) != centi)
+        {
+            failures++;
+        }
+    }
+    CHECK_EQUAL(0, failures);
+}
+
+int main()
+{
+    testF88ToCenti();
+    testCentiToF88();
+    testRoundTrip();
+    return testResult();
+}
@@ -0,0 +1,64 @@
+/*
+test_codec.cpp - Runtime lookup of data ID descriptors, see OpenThermCodec
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenThermCodec.h"
+#include "OpenThermTest.h"
+
+static void testDescriptorsAreSorted()
+{
+    CHECK(OpenThermCodec::getDescriptorCount() > 100);
+    for (byte i = 1; i < OpenThermCodec::getDescriptorCount(); i++)
+    {
+        CHECK((byte)OpenThermCodec::getDescriptor(i - 1).id < (byte)OpenThermCodec::getDescriptor(i).id);
+    }
+}
+
+static void testDescribe()
+{
+    OpenThermDataDescriptor descriptor;
+    CHECK(OpenThermCodec::describe(OpenThermMessageID::Tboiler, descriptor));
+    CHECK(descriptor.id == OpenThermMessageID::Tboiler);
+    CHECK(descriptor.format == OpenThermDataFormat::F8_8);
+    CHECK(descriptor.access == OpenThermDataAccess::READ);
+
+    CHECK(OpenThermCodec::describe(OpenThermMessageID::DayTime, descriptor));
+    CHECK(descriptor.format == OpenThermDataFormat::DAY_TIME);
+    CHECK(descriptor.access == OpenThermDataAccess::READ_WRITE);
+
+    // every descriptor is found by its ID, gaps are not
+    byte found = 0;
+    for (int id = 0; id < 256; id++)
+    {
+        if (OpenThermCodec::describe((OpenThermMessageID)id, descriptor))
+        {
+            CHECK_EQUAL(id, (byte)descriptor.id);
+            found++;
+        }
+    }
+    CHECK_EQUAL(OpenThermCodec::getDescriptorCount(), found);
+    CHECK(!OpenThermCodec::describe((OpenThermMessageID)200, descriptor));
+}
+
+#if OPENTHERM_STRINGS
+static void testNames()
+{
+    // program memory is ordinary memory on the host
+    CHECK(strcmp(reinterpret_cast<const char *>(OpenThermCodec::idToFlashString(OpenThermMessageID::Tboiler)), "Tboiler") == 0);
+    CHECK(strcmp(reinterpret_cast<const char *>(OpenThermCodec::idToFlashString((OpenThermMessageID)200)), "UNKNOWN") == 0);
+    OpenThermDataDescriptor descriptor;
+    CHECK(OpenThermCodec::describe(OpenThermMessageID::DayTime, descriptor));
+    CHECK(strcmp(descriptor.name, "DayTime") == 0);
+}
+#endif
+
+int main()
+{
+    testDescriptorsAreSorted();
+    testDescribe();
+#if OPENTHERM_STRINGS
+    testNames();
+#endif
+    return testResult();
+}
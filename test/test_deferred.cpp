@@ -0,0 +1,206 @@
+/*
+test_deferred.cpp - Deferred receive, see OpenTherm::setDeferredReceive
+Copyright 2023, Ihor Melnyk
+
+Edges of a response frame are played on the input pin. The interrupt handler
+only stores them, handleEdge() decodes them later from process().
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTest.h"
+
+struct Edge
+{
+    unsigned long time; // us from the start bit
+    int state;          // input pin, HIGH while the line is active
+};
+
+// READ_ACK Tboiler 45.5 (0xC0192D80), edges are up to 40us early or late
+static const Edge responseEdges[] = {
+    {0, HIGH}, {501, LOW}, {979, HIGH}, {1510, LOW}, {1966, HIGH}, {2469, LOW},
+    {3528, HIGH}, {3972, LOW}, {4506, HIGH}, {5034, LOW}, {5467, HIGH}, {6024, LOW},
+    {6487, HIGH}, {6964, LOW}, {7471, HIGH}, {8015, LOW}, {8513, HIGH}, {8968, LOW},
+    {9490, HIGH}, {9971, LOW}, {10530, HIGH}, {11014, LOW}, {11467, HIGH}, {12532, LOW},
+    {12975, HIGH}, {13488, LOW}, {14540, HIGH}, {15040, LOW}, {15534, HIGH}, {16467, LOW},
+    {17533, HIGH}, {18034, LOW}, {18510, HIGH}, {19466, LOW}, {20488, HIGH}, {21465, LOW},
+    {22031, HIGH}, {22477, LOW}, {23497, HIGH}, {24513, LOW}, {24978, HIGH}, {25529, LOW},
+    {26475, HIGH}, {27033, LOW}, {27499, HIGH}, {28031, LOW}, {28483, HIGH}, {28973, LOW},
+    {29534, HIGH}, {30033, LOW}, {30484, HIGH}, {31007, LOW}, {31472, HIGH}, {32030, LOW},
+    {32468, HIGH}, {33532, LOW},
+};
+static const int EDGE_COUNT = sizeof(responseEdges) / sizeof(responseEdges[0]);
+static const unsigned long RESPONSE = 0xC0192D80;
+
+OpenTherm master(2, 3);
+
+static unsigned long response = 0;
+static OpenThermResponseStatus responseStatus = OpenThermResponseStatus::NONE;
+static int responses = 0;
+
+static void handleResponse(unsigned long frame, OpenThermResponseStatus status, void *)
+{
+    response = frame;
+    responseStatus = status;
+    responses++;
+}
+
+// waits for the delay after the last conversation
+static void waitReady()
+{
+    while (!master.isReady())
+    {
+        OpenThermHost::advance(1000);
+        master.process();
+    }
+}
+
+// sends a request, the master waits for the response afterwards
+static void sendRequest()
+{
+    waitReady();
+    responses = 0;
+    master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0), handleResponse);
+    CHECK(master.status == OpenThermStatus::RESPONSE_WAITING);
+}
+
+// plays edges on the input pin, skipping one of them if skip is not negative
+// and adding short glitches after edge 10
+static void playEdges(unsigned long start, int skip = -1, int glitches = 0)
+{
+    for (int i = 0; i < EDGE_COUNT; i++)
+    {
+        OpenThermHost::state().micros = start + responseEdges[i].time;
+        if (i != skip)
+        {
+            OpenThermHost::setPin(2, responseEdges[i].state);
+        }
+        for (int j = 0; i == 10 && j < glitches; j++)
+        {
+            OpenThermHost::advance(2);
+            OpenThermHost::setPin(2, !responseEdges[i].state);
+            OpenThermHost::advance(2);
+            OpenThermHost::setPin(2, responseEdges[i].state);
+        }
+    }
+    OpenThermHost::setPin(2, LOW);
+}
+
+static void finish()
+{
+    // a broken frame is reported after the response timeout
+    for (int i = 0; i < 1500 && responses == 0; i++)
+    {
+        OpenThermHost::advance(1000);
+        master.process();
+    }
+}
+
+static void testDecodedFromTimestamps()
+{
+    sendRequest();
+    // edges are only buffered until process() is called, long after the frame has ended
+    playEdges(micros() + 20000);
+    CHECK(master.status == OpenThermStatus::RESPONSE_WAITING);
+    OpenThermHost::advance(50000);
+    finish();
+    CHECK_EQUAL(1, responses);
+    CHECK(responseStatus == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(RESPONSE, response);
+    CHECK_EQUAL(0, master.getEdgeOverflows());
+}
+
+static void testProcessedWhileReceiving()
+{
+    sendRequest();
+    const unsigned long start = micros() + 20000;
+    for (int i = 0; i < EDGE_COUNT; i++)
+    {
+        OpenThermHost::state().micros = start + responseEdges[i].time;
+        OpenThermHost::setPin(2, responseEdges[i].state);
+        if (i % 7 == 0)
+        {
+            master.process();
+        }
+    }
+    finish();
+    CHECK_EQUAL(1, responses);
+    CHECK(responseStatus == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(RESPONSE, response);
+}
+
+static void testMissingEdge()
+{
+    sendRequest();
+    // the mid-bit edge of a data bit is lost
+    playEdges(micros() + 20000, 20);
+    finish();
+    CHECK_EQUAL(1, responses);
+    CHECK(responseStatus != OpenThermResponseStatus::SUCCESS);
+}
+
+static void testGlitches()
+{
+    sendRequest();
+    // glitches are buffered, but ignored by handleEdge() within a bit
+    playEdges(micros() + 20000, -1, 20);
+    finish();
+    CHECK_EQUAL(1, responses);
+    CHECK(responseStatus == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(RESPONSE, response);
+}
+
+static void testOverflowAfterFrame()
+{
+    sendRequest();
+    const unsigned long overflows = master.getEdgeOverflows();
+    // edges after a complete frame are lost, the frame itself is intact
+    playEdges(micros() + 20000);
+    playEdges(micros() + 20000);
+    playEdges(micros() + 20000);
+    CHECK(master.getEdgeOverflows() > overflows);
+    finish();
+    CHECK_EQUAL(1, responses);
+    CHECK(responseStatus == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(RESPONSE, response);
+}
+
+static void testOverflowWithinFrame()
+{
+    sendRequest();
+    const unsigned long overflows = master.getEdgeOverflows();
+    // glitches fill the buffer, the rest of the frame is lost
+    playEdges(micros() + 20000, -1, 64);
+    CHECK(master.getEdgeOverflows() > overflows);
+    finish();
+    CHECK_EQUAL(1, responses);
+    CHECK(responseStatus == OpenThermResponseStatus::INVALID);
+}
+
+static void testEdgesIgnoredWhenReady()
+{
+    waitReady();
+    const unsigned long overflows = master.getEdgeOverflows();
+    for (int i = 0; i < 3; i++)
+    {
+        playEdges(micros() + 1000);
+    }
+    CHECK_EQUAL(overflows, master.getEdgeOverflows());
+    master.process();
+    CHECK(master.isReady());
+}
+
+int main()
+{
+    testReset();
+    master.begin();
+    master.setDeferredReceive(true);
+
+    testDecodedFromTimestamps();
+    testProcessedWhileReceiving();
+    testMissingEdge();
+    testGlitches();
+    testOverflowAfterFrame();
+    testOverflowWithinFrame();
+    testEdgesIgnoredWhenReady();
+    return testResult();
+}
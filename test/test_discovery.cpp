@@ -0,0 +1,59 @@
+/*
+test_discovery.cpp - Learning which data IDs the slave supports, see OpenTherm::startDiscovery
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+
+// calls master process() only while a frame is in progress, the way OpenThermTask sleeps
+// while the master is idle and has no requests queued
+static bool discover(unsigned long us)
+{
+    master.startDiscovery();
+    master.process();
+    for (unsigned long i = 0; i < us && master.isDiscovering(); i += 100)
+    {
+        OpenThermHost::advance(100);
+        if (!master.isReady())
+        {
+            master.process();
+        }
+        boiler.process();
+    }
+    return !master.isDiscovering();
+}
+
+static void testDiscoveryCompletes()
+{
+    CHECK(discover(60000000));
+    CHECK(master.getIdSupport(OpenThermMessageID::Tboiler, OpenThermMessageType::READ_DATA) == OpenThermIdSupport::SUPPORTED);
+    CHECK(master.getIdSupport(OpenThermMessageID::Tdhw, OpenThermMessageType::READ_DATA) == OpenThermIdSupport::SUPPORTED);
+    CHECK(master.getIdSupport(OpenThermMessageID::Tret, OpenThermMessageType::READ_DATA) == OpenThermIdSupport::UNSUPPORTED);
+    CHECK(master.getIdSupport(OpenThermMessageID::Status, OpenThermMessageType::READ_DATA) == OpenThermIdSupport::UNKNOWN);
+}
+
+static void testGettersSkipUnsupportedIds()
+{
+    const unsigned long responses = boiler.getResponseCount();
+    OpenThermResponseStatus status = OpenThermResponseStatus::NONE;
+    CHECK_EQUAL(0, master.getReturnTemperature(&status));
+    CHECK(status == OpenThermResponseStatus::INVALID);
+    CHECK(master.isReady());
+    CHECK_EQUAL(responses, boiler.getResponseCount());
+}
+
+int main()
+{
+    loopback.begin();
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    boiler.setFloat(OpenThermMessageID::Tdhw, 52.25);
+
+    testDiscoveryCompletes();
+    testGettersSkipUnsupportedIds();
+    return testResult();
+}
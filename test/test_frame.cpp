@@ -0,0 +1,108 @@
+/*
+test_frame.cpp - Optimized frame helpers against the reference implementations
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermReference.h"
+#include "OpenThermTest.h"
+
+static uint64_t randomState = 0x9E3779B97F4A7C15ull;
+
+static unsigned long random64()
+{
+    // xorshift64
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return (unsigned long)randomState;
+}
+
+// every combination of the upper 24 bits, the low byte is random
+static void testFrames()
+{
+    unsigned long mismatches = 0;
+    for (unsigned long high = 0; high < (1ul << 24); high++)
+    {
+        const unsigned long frame = (high << 8) | (random64() & 0xFF);
+        mismatches += OpenTherm::parity(frame) != OpenThermReference::parity(frame);
+        mismatches += OpenTherm::isValidResponse(frame) != OpenThermReference::isValidResponse(frame);
+        mismatches += OpenTherm::isValidRequest(frame) != OpenThermReference::isValidRequest(frame);
+    }
+    CHECK_EQUAL(0, mismatches);
+}
+
+// unsigned long is wider than a frame on some targets
+static void testRandomWords()
+{
+    unsigned long mismatches = 0;
+    for (unsigned long i = 0; i < (1ul << 20); i++)
+    {
+        const unsigned long word = random64();
+        mismatches += OpenTherm::parity(word) != OpenThermReference::parity(word);
+        mismatches += OpenTherm::isValidResponse(word) != OpenThermReference::isValidResponse(word);
+        mismatches += OpenTherm::isValidRequest(word) != OpenThermReference::isValidRequest(word);
+    }
+    CHECK_EQUAL(0, mismatches);
+}
+
+static void testBuild()
+{
+    unsigned long mismatches = 0;
+    for (int type = 0; type < 8; type++)
+    {
+        for (int id = 0; id < 256; id++)
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                const unsigned int data = random64() & 0xFFFF;
+                mismatches += OpenTherm::buildRequest((OpenThermMessageType)type, (OpenThermMessageID)id, data) !=
+                              OpenThermReference::buildRequest((OpenThermMessageType)type, (OpenThermMessageID)id, data);
+                mismatches += OpenTherm::buildResponse((OpenThermMessageType)type, (OpenThermMessageID)id, data) !=
+                              OpenThermReference::buildResponse((OpenThermMessageType)type, (OpenThermMessageID)id, data);
+            }
+        }
+    }
+    CHECK_EQUAL(0, mismatches);
+}
+
+// every data value, compared bit for bit
+static void testGetFloat()
+{
+    unsigned long mismatches = 0;
+    for (unsigned long data = 0; data < 0x10000; data++)
+    {
+        const unsigned long frame = (random64() & 0xFFFF0000ul) | data;
+        const float value = OpenTherm::getFloat(frame);
+        const float reference = OpenThermReference::getFloat(frame);
+        mismatches += memcmp(&value, &reference, sizeof(float)) != 0;
+    }
+    CHECK_EQUAL(0, mismatches);
+}
+
+static void testValidateResponses()
+{
+    unsigned long frames[256];
+    bool valid[256];
+    unsigned int expected = 0;
+    for (int i = 0; i < 256; i++)
+    {
+        frames[i] = random64() & 0xFFFFFFFFul;
+        expected += OpenThermReference::isValidResponse(frames[i]);
+    }
+    CHECK_EQUAL(expected, OpenTherm::validateResponses(frames, 256, valid));
+    for (int i = 0; i < 256; i++)
+    {
+        CHECK(valid[i] == OpenThermReference::isValidResponse(frames[i]));
+    }
+}
+
+int main()
+{
+    testFrames();
+    testRandomWords();
+    testBuild();
+    testGetFloat();
+    testValidateResponses();
+    return testResult();
+}
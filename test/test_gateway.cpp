@@ -0,0 +1,204 @@
+/*
+test_gateway.cpp - Gateway rules and OTGW commands, see OpenThermGateway
+Copyright 2023, Ihor Melnyk
+
+Thermostat, gateway and boiler are connected through loopback pins.
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermGateway.h"
+#include "OpenThermOtgw.h"
+#include "OpenThermTest.h"
+
+OpenTherm thermostat(2, 3);
+OpenThermGateway gateway(6, 7, 4, 5);
+OpenThermTestBoiler boiler(8, 9);
+
+static unsigned long boilerRequest = 0;
+
+static void handleFrame(OpenThermGatewayFrame type, unsigned long frame, void *)
+{
+    if (type == OpenThermGatewayFrame::BOILER_REQUEST)
+    {
+        boilerRequest = frame;
+    }
+}
+
+static void run(unsigned long us)
+{
+    for (unsigned long i = 0; i < us; i += 100)
+    {
+        OpenThermHost::advance(100);
+        thermostat.process();
+        gateway.process();
+        boiler.process();
+    }
+}
+
+static OpenThermOtgwStatus command(const char *line)
+{
+    static OpenThermOtgwParser parser;
+    OpenThermOtgwStatus status = OpenThermOtgwStatus::NONE;
+    for (const char *c = line; *c != 0; c++)
+    {
+        status = parser.feed(*c);
+    }
+    if (status == OpenThermOtgwStatus::COMMAND)
+    {
+        status = OpenThermOtgwParser::apply(gateway, parser.getCommand());
+    }
+    return status;
+}
+
+static unsigned long response = 0;
+
+static void handleResponse(unsigned long frame, OpenThermResponseStatus status, void *)
+{
+    response = status == OpenThermResponseStatus::SUCCESS ? frame : 0;
+}
+
+// thermostat writes a setpoint through the gateway
+static void write(OpenThermMessageID id, uint16_t data)
+{
+    response = 0;
+    boilerRequest = 0;
+    CHECK(thermostat.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::WRITE_DATA, id, data), handleResponse));
+    run(500000);
+}
+
+static void testControlSetpointOverride()
+{
+    CHECK(command("CS=60\r") == OpenThermOtgwStatus::COMMAND);
+    write(OpenThermMessageID::TSet, 0x2800);
+    // boiler gets the override, thermostat the acknowledgement of its own value
+    CHECK_EQUAL(OpenTherm::buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TSet, 0x3C00), boilerRequest);
+    CHECK_EQUAL(0x3C00, boiler.getValue(OpenThermMessageID::TSet));
+    CHECK(OpenTherm::getMessageType(response) == OpenThermMessageType::WRITE_ACK);
+    CHECK_EQUAL(0x2800, response & 0xFFFF);
+    CHECK_EQUAL(1, gateway.getOverriddenCount());
+
+    // cancelled, the thermostat value is forwarded again
+    CHECK(command("CS=0\r") == OpenThermOtgwStatus::COMMAND);
+    write(OpenThermMessageID::TSet, 0x2800);
+    CHECK_EQUAL(0x2800, boilerRequest & 0xFFFF);
+    CHECK_EQUAL(0x2800, boiler.getValue(OpenThermMessageID::TSet));
+}
+
+static void testDhwSetpointAndModulationOverride()
+{
+    CHECK(command("SW=45.5\r") == OpenThermOtgwStatus::COMMAND);
+    write(OpenThermMessageID::TdhwSet, 0x3C00);
+    CHECK_EQUAL(0x2D80, boilerRequest & 0xFFFF);
+    CHECK_EQUAL(0x2D80, boiler.getValue(OpenThermMessageID::TdhwSet));
+    CHECK_EQUAL(0x3C00, response & 0xFFFF);
+
+    CHECK(command("MM=50\r") == OpenThermOtgwStatus::COMMAND);
+    write(OpenThermMessageID::MaxRelModLevelSetting, 0x6400);
+    CHECK_EQUAL(0x3200, boilerRequest & 0xFFFF);
+    CHECK_EQUAL(0x3200, boiler.getValue(OpenThermMessageID::MaxRelModLevelSetting));
+}
+
+static void testReadOverride()
+{
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    CHECK(gateway.overrideValue(OpenThermMessageID::Tboiler, 0x1E00));
+    response = 0;
+    boilerRequest = 0;
+    CHECK(thermostat.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0), handleResponse));
+    run(500000);
+    CHECK_EQUAL(0x1E00, response & 0xFFFF);
+    // answered by the gateway
+    CHECK_EQUAL(0, boilerRequest);
+}
+
+// thermostat reads through the gateway
+static void read(OpenThermMessageID id, uint16_t data)
+{
+    response = 0;
+    boilerRequest = 0;
+    CHECK(thermostat.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, id, data), handleResponse));
+    run(500000);
+}
+
+static void testStatusIsNotAnsweredFromCache()
+{
+    gateway.clearRule(OpenThermMessageID::Tboiler);
+    gateway.setCacheMaxAge(5000);
+    read(OpenThermMessageID::Tboiler, 0);
+    CHECK(boilerRequest != 0);
+    read(OpenThermMessageID::Tboiler, 0);
+    CHECK_EQUAL(0, boilerRequest);
+    CHECK_EQUAL(0x2D80, response & 0xFFFF);
+
+    // CH on, then CH and DHW off
+    read(OpenThermMessageID::Status, 0x0100);
+    CHECK_EQUAL(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Status, 0x0100), boilerRequest);
+    const unsigned long cached = gateway.getCachedCount();
+    read(OpenThermMessageID::Status, 0);
+    CHECK_EQUAL(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Status, 0), boilerRequest);
+    CHECK(OpenTherm::getMessageType(response) == OpenThermMessageType::READ_ACK);
+
+    // indexed reads with index 0
+    read(OpenThermMessageID::TSPindexTSPvalue, 0x0100);
+    read(OpenThermMessageID::TSPindexTSPvalue, 0);
+    CHECK_EQUAL(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::TSPindexTSPvalue, 0), boilerRequest);
+    CHECK_EQUAL(cached, gateway.getCachedCount());
+    gateway.setCacheMaxAge(0);
+}
+
+// limits of 128 and more are valid, they are saturated to the f8.8 range
+static void testClampLimitsSaturate()
+{
+    CHECK(gateway.clampValue(OpenThermMessageID::TSet, 20, 200));
+    write(OpenThermMessageID::TSet, 0x5000);
+    CHECK_EQUAL(0x5000, boilerRequest & 0xFFFF);
+    write(OpenThermMessageID::TSet, 0x0A00);
+    CHECK_EQUAL(0x1400, boilerRequest & 0xFFFF);
+
+    CHECK(gateway.clampValue(OpenThermMessageID::TSet, -200, 128));
+    write(OpenThermMessageID::TSet, 0x7F00);
+    CHECK_EQUAL(0x7F00, boilerRequest & 0xFFFF);
+    write(OpenThermMessageID::TSet, 0x8000);
+    CHECK_EQUAL(0x8000, boilerRequest & 0xFFFF);
+    gateway.clearRule(OpenThermMessageID::TSet);
+}
+
+// the base Print reports no free space, such a stream gets OPENTHERM_FLUSH_CHUNK bytes per flush
+static void testFlushToStreamWithoutFreeSpace()
+{
+    char buffer[32];
+    OpenThermOtgwWriter writer(buffer, sizeof(buffer));
+    OpenThermTestOutput output;
+    CHECK(writer.writeFrame('T', 0x10190000));
+    CHECK(writer.writeFrame('B', 0x50192D80));
+    CHECK_EQUAL(OPENTHERM_FLUSH_CHUNK, writer.flush(output));
+    CHECK_EQUAL(2 * OpenThermOtgwWriter::FRAME_LINE_SIZE - OPENTHERM_FLUSH_CHUNK, writer.flush(output));
+    CHECK_EQUAL(0, writer.available());
+    CHECK(strcmp(output.text, "T10190000\r\nB50192D80\r\n") == 0);
+}
+
+int main()
+{
+    testReset();
+    // thermostat to the slave side of the gateway, its master side to the boiler
+    OpenThermTestPin::link(3, 4);
+    OpenThermTestPin::link(5, 2);
+    boiler.connect(6, 7);
+    thermostat.begin();
+    gateway.begin();
+    gateway.setFrameHandler(handleFrame);
+    boiler.begin();
+    boiler.setValue(OpenThermMessageID::TSet, 0, OpenThermDataAccess::WRITE);
+    boiler.setValue(OpenThermMessageID::TdhwSet, 0, OpenThermDataAccess::READ_WRITE);
+    boiler.setValue(OpenThermMessageID::MaxRelModLevelSetting, 0, OpenThermDataAccess::WRITE);
+    boiler.setValue(OpenThermMessageID::Status, 0x000A);
+    boiler.setValue(OpenThermMessageID::TSPindexTSPvalue, 0x0132);
+
+    testControlSetpointOverride();
+    testDhwSetpointAndModulationOverride();
+    testReadOverride();
+    testStatusIsNotAnsweredFromCache();
+    testClampLimitsSaturate();
+    testFlushToStreamWithoutFreeSpace();
+    return testResult();
+}
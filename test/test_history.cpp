@@ -0,0 +1,72 @@
+/*
+test_history.cpp - Sequence counter of history readers, see OpenThermHistory::get
+Copyright 2023, Ihor Melnyk
+
+A reader which preempted the writer sees an odd sequence until the writer
+continues, it must give up instead of waiting for it.
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermHistory.h"
+#include "OpenThermTest.h"
+
+OpenTherm master(2, 3);
+
+OpenThermHistorySample samples[4];
+OpenThermHistoryBucket minutes[4];
+OpenThermHistorySeries series[] = {
+    {OpenThermMessageID::Tboiler, samples, 4, minutes, 4, NULL, 0, 0, 0, 0, 0, 0, 0, 0},
+};
+OpenThermHistory history(master, series, 1);
+
+static unsigned long tboiler(unsigned int value)
+{
+    return OpenTherm::buildResponse(OpenThermMessageType::READ_ACK, OpenThermMessageID::Tboiler, value);
+}
+
+static void testConsistentRead()
+{
+    history.record(tboiler(0x2D00), 1000);
+    history.record(tboiler(0x2E00), 2000);
+    OpenThermHistoryBucket bucket;
+    CHECK(history.get(OpenThermMessageID::Tboiler, OpenThermHistoryResolution::RAW, 0, bucket));
+    CHECK_EQUAL(0x2E00, bucket.min);
+    CHECK(history.get(OpenThermMessageID::Tboiler, OpenThermHistoryResolution::MINUTE, 0, bucket));
+    CHECK_EQUAL(2, bucket.count);
+    CHECK(!history.get(OpenThermMessageID::Tboiler, OpenThermHistoryResolution::HOUR, 0, bucket));
+    CHECK(!history.get(OpenThermMessageID::Tboiler, OpenThermHistoryResolution::RAW, 2, bucket));
+}
+
+static void testUpdateInProgress()
+{
+    OpenThermHistoryBucket bucket;
+    // the writer was preempted between the increments of the sequence
+    series[0].sequence = series[0].sequence + 1;
+    CHECK(!history.get(OpenThermMessageID::Tboiler, OpenThermHistoryResolution::RAW, 0, bucket));
+    CHECK(!history.get(OpenThermMessageID::Tboiler, OpenThermHistoryResolution::MINUTE, 0, bucket));
+
+    // and finished its update later
+    series[0].sequence = series[0].sequence + 1;
+    CHECK(history.get(OpenThermMessageID::Tboiler, OpenThermHistoryResolution::RAW, 0, bucket));
+    CHECK_EQUAL(0x2E00, bucket.max);
+}
+
+static void testClearKeepsSequenceEven()
+{
+    history.clear();
+    CHECK_EQUAL(0, series[0].sequence & 1);
+    CHECK_EQUAL(0, history.getCount(OpenThermMessageID::Tboiler, OpenThermHistoryResolution::RAW));
+    history.record(tboiler(0x3000), 3000);
+    OpenThermHistoryBucket bucket;
+    CHECK(history.get(OpenThermMessageID::Tboiler, OpenThermHistoryResolution::RAW, 0, bucket));
+    CHECK_EQUAL(0x3000, bucket.sum);
+}
+
+int main()
+{
+    testReset();
+    testConsistentRead();
+    testUpdateInProgress();
+    testClearKeepsSequenceEven();
+    return testResult();
+}
@@ -0,0 +1,110 @@
+/*
+test_queue.cpp - Request queue, see OpenTherm::enqueueRequest
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+
+struct Calls
+{
+    unsigned long responses[OPENTHERM_REQUEST_QUEUE_SIZE + 2];
+    OpenThermResponseStatus statuses[OPENTHERM_REQUEST_QUEUE_SIZE + 2];
+    int count;
+};
+
+static void handleResponse(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    Calls *calls = static_cast<Calls *>(context);
+    if (calls->count < OPENTHERM_REQUEST_QUEUE_SIZE + 2)
+    {
+        calls->responses[calls->count] = response;
+        calls->statuses[calls->count] = status;
+    }
+    calls->count++;
+}
+
+static unsigned long readRequest(byte id)
+{
+    return OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, (OpenThermMessageID)id, 0);
+}
+
+// the first request is sent at once, the queue takes OPENTHERM_REQUEST_QUEUE_SIZE more
+static void testOverflowIsDropped()
+{
+    Calls calls = {};
+    for (byte i = 0; i <= OPENTHERM_REQUEST_QUEUE_SIZE; i++)
+    {
+        CHECK(master.enqueueRequest(readRequest(25 + i), handleResponse, &calls));
+    }
+    CHECK_EQUAL(OPENTHERM_REQUEST_QUEUE_SIZE, master.getQueueDepth());
+    CHECK(!master.enqueueRequest(readRequest(25 + OPENTHERM_REQUEST_QUEUE_SIZE + 1), handleResponse, &calls));
+    CHECK_EQUAL(1, master.getQueueDrops());
+    CHECK_EQUAL(OPENTHERM_REQUEST_QUEUE_SIZE, master.getMaxQueueDepth());
+
+    loopback.run((OPENTHERM_REQUEST_QUEUE_SIZE + 1) * 500000ul);
+    CHECK_EQUAL(0, master.getQueueDepth());
+    // answered in order, the dropped request has no handler call
+    CHECK_EQUAL(OPENTHERM_REQUEST_QUEUE_SIZE + 1, calls.count);
+    for (byte i = 0; i <= OPENTHERM_REQUEST_QUEUE_SIZE; i++)
+    {
+        CHECK(calls.statuses[i] == OpenThermResponseStatus::SUCCESS);
+        CHECK_EQUAL(25 + i, (calls.responses[i] >> 16) & 0xFF);
+        CHECK_EQUAL(i, calls.responses[i] & 0xFFFF);
+    }
+}
+
+static void testUnknownIdGetsInvalid()
+{
+    Calls calls = {};
+    CHECK(master.enqueueRequest(readRequest(120), handleResponse, &calls));
+    loopback.run(500000);
+    CHECK_EQUAL(1, calls.count);
+    CHECK(calls.statuses[0] == OpenThermResponseStatus::INVALID);
+    CHECK(OpenTherm::getMessageType(calls.responses[0]) == OpenThermMessageType::UNKNOWN_DATA_ID);
+}
+
+// handler is called once, with the status of the last attempt
+static void testRetriedRequestGetsFinalStatus()
+{
+    master.setRetryPolicy(OpenThermRetryPolicy(2, 100, 1000));
+    boiler.disconnect();
+    Calls calls = {};
+    CHECK(master.enqueueRequest(readRequest(25), handleResponse, &calls));
+    // timeout after 1s, then 100ms backoff
+    loopback.run(1050000);
+    CHECK_EQUAL(0, calls.count);
+    loopback.run(2000000);
+    CHECK_EQUAL(1, calls.count);
+    CHECK(calls.statuses[0] == OpenThermResponseStatus::TIMEOUT);
+    CHECK_EQUAL(0, calls.responses[0]);
+
+    // answered on the retry
+    calls.count = 0;
+    CHECK(master.enqueueRequest(readRequest(26), handleResponse, &calls));
+    loopback.run(1050000);
+    boiler.reconnect();
+    loopback.run(1000000);
+    CHECK_EQUAL(1, calls.count);
+    CHECK(calls.statuses[0] == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(1, calls.responses[0] & 0xFFFF);
+    master.setRetryPolicy(OpenThermRetryPolicy());
+}
+
+int main()
+{
+    loopback.begin();
+    for (byte i = 0; i < OPENTHERM_REQUEST_QUEUE_SIZE + 2; i++)
+    {
+        boiler.setValue((OpenThermMessageID)(25 + i), i);
+    }
+
+    testOverflowIsDropped();
+    testUnknownIdGetsInvalid();
+    testRetriedRequestGetsFinalStatus();
+    return testResult();
+}
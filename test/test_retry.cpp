@@ -0,0 +1,60 @@
+/*
+test_retry.cpp - Retry policy of queued requests and futures, see OpenThermRetryPolicy
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermFuture.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+OpenThermStats stats;
+
+// the first attempt times out, the boiler is connected during the backoff
+static void testFutureIsRetried()
+{
+    boiler.disconnect();
+    OpenThermFuture future;
+    CHECK(master.sendRequestAsync(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0), future));
+    // timeout after 1s, then 100ms backoff
+    loopback.run(1050000);
+    CHECK(future.isPending());
+    boiler.reconnect();
+    loopback.run(1000000);
+    CHECK(future.isDone());
+    CHECK(future.getStatus() == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(0x2D80, future.getResponse() & 0xFFFF);
+
+    OpenThermStats snapshot;
+    CHECK(master.getStats(snapshot));
+    CHECK_EQUAL(1, snapshot.retries);
+}
+
+static void testFutureGetsLastAttempt()
+{
+    boiler.disconnect();
+    OpenThermFuture future;
+    CHECK(master.sendRequestAsync(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0), future));
+    loopback.run(5000000);
+    CHECK(future.isDone());
+    CHECK(future.getStatus() == OpenThermResponseStatus::TIMEOUT);
+
+    OpenThermStats snapshot;
+    CHECK(master.getStats(snapshot));
+    CHECK_EQUAL(1 + 2, snapshot.retries);
+    boiler.reconnect();
+}
+
+int main()
+{
+    loopback.begin();
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    master.setStats(&stats);
+    master.setRetryPolicy(OpenThermRetryPolicy(3, 100, 1000));
+
+    testFutureIsRetried();
+    testFutureGetsLastAttempt();
+    return testResult();
+}
@@ -0,0 +1,102 @@
+/*
+test_scheduler.cpp - Earliest deadline first polling, see OpenThermScheduler
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermScheduler.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+
+struct Order
+{
+    byte ids[16];
+    int count;
+};
+
+static void handleResponse(unsigned long response, OpenThermResponseStatus, void *context)
+{
+    Order *order = static_cast<Order *>(context);
+    if (order->count < 16)
+    {
+        order->ids[order->count++] = (byte)OpenTherm::getDataID(response);
+    }
+}
+
+static OpenThermPollEntry makeEntry(OpenThermMessageID id, unsigned long period, byte priority)
+{
+    OpenThermPollEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.id = id;
+    entry.period = period;
+    entry.priority = priority;
+    return entry;
+}
+
+static void run(OpenThermScheduler &scheduler, unsigned long us)
+{
+    for (unsigned long i = 0; i < us; i += 1000)
+    {
+        loopback.run(1000);
+        scheduler.process();
+    }
+}
+
+// all entries are due at the start, ties go to the higher priority, then the earliest deadline goes first
+static void testEarliestDeadlineFirst()
+{
+    OpenThermPollEntry entries[] = {
+        makeEntry(OpenThermMessageID::Tboiler, 1000, 1),
+        makeEntry(OpenThermMessageID::Tret, 1000, 2),
+        makeEntry(OpenThermMessageID::Tdhw, 600, 0),
+    };
+    OpenThermScheduler scheduler(master, entries, 3);
+    Order order = {};
+    scheduler.begin(handleResponse, &order);
+    run(scheduler, 1200000);
+
+    CHECK(order.count >= 7);
+    CHECK_EQUAL(OpenThermMessageID::Tret, order.ids[0]);
+    CHECK_EQUAL(OpenThermMessageID::Tboiler, order.ids[1]);
+    CHECK_EQUAL(OpenThermMessageID::Tdhw, order.ids[2]);
+    // Tdhw is due again before the others
+    CHECK_EQUAL(OpenThermMessageID::Tdhw, order.ids[3]);
+    CHECK_EQUAL(OpenThermMessageID::Tret, order.ids[4]);
+    CHECK_EQUAL(OpenThermMessageID::Tboiler, order.ids[5]);
+    CHECK_EQUAL(OpenThermMessageID::Tdhw, order.ids[6]);
+    CHECK_EQUAL(0, scheduler.getMisses(OpenThermMessageID::Tret));
+    CHECK_EQUAL(0, scheduler.getMisses(OpenThermMessageID::Tdhw));
+}
+
+// each request waits for a 1s timeout while the boiler is disconnected
+static void testDeadlineMisses()
+{
+    OpenThermPollEntry entries[] = {
+        makeEntry(OpenThermMessageID::Tboiler, 300, 1),
+        makeEntry(OpenThermMessageID::Tdhw, 5000, 0),
+    };
+    OpenThermScheduler scheduler(master, entries, 2);
+    scheduler.begin();
+    boiler.disconnect();
+    run(scheduler, 4500000);
+    boiler.reconnect();
+    CHECK(scheduler.getMisses(OpenThermMessageID::Tboiler) >= 2);
+    CHECK_EQUAL(0, scheduler.getMisses(OpenThermMessageID::Tdhw));
+    CHECK(scheduler.getAchievedPeriod(OpenThermMessageID::Tboiler) > 1000);
+    CHECK_EQUAL(0, scheduler.getMisses(OpenThermMessageID::CHPressure));
+}
+
+int main()
+{
+    loopback.begin();
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    boiler.setFloat(OpenThermMessageID::Tret, 30);
+    boiler.setFloat(OpenThermMessageID::Tdhw, 52.25);
+
+    testEarliestDeadlineFirst();
+    testDeadlineMisses();
+    return testResult();
+}
@@ -0,0 +1,111 @@
+/*
+test_stats.cpp - Bus statistics, see OpenTherm::getStats
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+OpenThermStats stats;
+
+// answers requests with raw frames instead of the boiler
+OpenTherm raw(6, 7, true);
+static unsigned long rawRequest = 0;
+static unsigned long rawResponse = 0;
+
+static void handleRawRequest(unsigned long request, OpenThermResponseStatus status, void *)
+{
+    if (status == OpenThermResponseStatus::SUCCESS)
+    {
+        rawRequest = request;
+    }
+}
+
+static void processRaw()
+{
+    raw.process();
+    if (rawRequest != 0 && raw.isReady() && raw.sendResponse(rawResponse))
+    {
+        rawRequest = 0;
+    }
+}
+
+static void read(OpenThermMessageID id)
+{
+    CHECK(master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, id, 0)));
+    loopback.run(500000);
+}
+
+static void readRaw(unsigned long response)
+{
+    OpenThermTestPin::link(3, 6);
+    OpenThermTestPin::link(7, 2);
+    rawResponse = response;
+    loopback.tick = processRaw;
+    read(OpenThermMessageID::Tboiler);
+    loopback.tick = NULL;
+    boiler.connect(2, 3);
+}
+
+static void testNoStats()
+{
+    OpenThermStats snapshot;
+    CHECK(!master.getStats(snapshot));
+}
+
+static void testCounters()
+{
+    // the second request follows the first after the inter-frame delay
+    CHECK(master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0)));
+    read(OpenThermMessageID::Tboiler);
+    // UNKNOWN_DATA_ID is a valid frame of a type which isn't an acknowledgement
+    read(OpenThermMessageID::Tret);
+    readRaw(OpenTherm::buildResponse(OpenThermMessageType::READ_ACK, OpenThermMessageID::Tboiler, 0x2D80) ^ 0x80000000);
+    readRaw(OpenTherm::buildResponse(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::Tboiler, 0x2D80));
+    boiler.disconnect();
+    read(OpenThermMessageID::Tboiler);
+    loopback.run(1000000);
+    boiler.reconnect();
+
+    OpenThermStats snapshot;
+    CHECK(master.getStats(snapshot));
+    CHECK_EQUAL(6, snapshot.framesSent);
+    CHECK_EQUAL(5, snapshot.framesReceived);
+    CHECK_EQUAL(2, snapshot.success);
+    CHECK_EQUAL(3, snapshot.invalid);
+    CHECK_EQUAL(1, snapshot.timeout);
+    CHECK_EQUAL(1, snapshot.parityErrors);
+    CHECK_EQUAL(2, snapshot.invalidMessageTypes);
+    CHECK_EQUAL(0, snapshot.retries);
+    CHECK_EQUAL(master.getQueueDrops(), snapshot.queueDrops);
+
+    // a conversation takes two frames and the slave delay, 64..127ms, and the timeout over 1s
+    CHECK_EQUAL(5, snapshot.latencyHistogram[3]);
+    CHECK_EQUAL(1, snapshot.latencyHistogram[OPENTHERM_HISTOGRAM_BUCKETS - 1]);
+    // 100ms inter-frame delay is in 96..191ms, the requests after a 500ms read in 256..511ms
+    CHECK_EQUAL(1, snapshot.frameGapHistogram[2]);
+    CHECK_EQUAL(4, snapshot.frameGapHistogram[4]);
+    unsigned long interrupts = 0;
+    for (byte i = 0; i < OPENTHERM_HISTOGRAM_BUCKETS; i++)
+    {
+        interrupts += snapshot.isrTimeHistogram[i];
+    }
+    CHECK(interrupts > 0);
+}
+
+int main()
+{
+    loopback.begin();
+    raw.begin();
+    OpenThermResponseListener listener = {handleRawRequest, NULL, NULL};
+    raw.addResponseListener(&listener);
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+
+    testNoStats();
+    master.setStats(&stats);
+    testCounters();
+    return testResult();
+}
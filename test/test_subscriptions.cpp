@@ -0,0 +1,130 @@
+/*
+test_subscriptions.cpp - Handlers changing subscriptions during dispatch, see OpenThermSubscriptions
+Copyright 2023, Ihor Melnyk
+
+Subscriptions of an ID are chained from the newest one, dispatch saves the
+next index before a handler is called.
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermSubscriptions.h"
+#include "OpenThermTest.h"
+
+OpenTherm master(2, 3);
+OpenThermSubscriptions subscriptions(master);
+
+struct Subscriber
+{
+    int calls;
+    unsigned long response;
+    OpenThermSubscription *subscription;
+    OpenThermSubscription **unsubscribe; // unsubscribed by the handler if not NULL
+    OpenThermMessageID subscribeId;      // subscribed by the handler if not Status
+};
+
+static Subscriber first;
+static Subscriber second;
+static Subscriber third;
+static Subscriber added;
+
+static void handleChange(unsigned long response, uint16_t, void *context)
+{
+    Subscriber *subscriber = static_cast<Subscriber *>(context);
+    subscriber->calls++;
+    subscriber->response = response;
+    if (subscriber->unsubscribe != NULL)
+    {
+        subscriptions.unsubscribe(*subscriber->unsubscribe);
+        *subscriber->unsubscribe = NULL;
+        subscriber->unsubscribe = NULL;
+    }
+    if (subscriber->subscribeId != OpenThermMessageID::Status)
+    {
+        added.subscription = subscriptions.subscribe(subscriber->subscribeId, handleChange, &added);
+        subscriber->subscribeId = OpenThermMessageID::Status;
+    }
+}
+
+static unsigned long tboiler(unsigned int value)
+{
+    return OpenTherm::buildResponse(OpenThermMessageType::READ_ACK, OpenThermMessageID::Tboiler, value);
+}
+
+static void subscribe(Subscriber &subscriber)
+{
+    subscriber = Subscriber();
+    subscriber.subscribeId = OpenThermMessageID::Status;
+    subscriber.subscription = subscriptions.subscribe(OpenThermMessageID::Tboiler, handleChange, &subscriber);
+    CHECK(subscriber.subscription != NULL);
+}
+
+static void unsubscribeAll()
+{
+    Subscriber *subscribers[] = {&first, &second, &third, &added};
+    for (Subscriber *subscriber : subscribers)
+    {
+        subscriptions.unsubscribe(subscriber->subscription);
+        subscriber->subscription = NULL;
+    }
+}
+
+static void testHandlerUnsubscribesItself()
+{
+    subscribe(first);
+    subscribe(second);
+    second.unsubscribe = &second.subscription;
+    subscriptions.dispatch(tboiler(0x2D00));
+    CHECK_EQUAL(1, second.calls);
+    CHECK_EQUAL(1, first.calls);
+    subscriptions.dispatch(tboiler(0x2E00));
+    CHECK_EQUAL(1, second.calls);
+    CHECK_EQUAL(2, first.calls);
+    unsubscribeAll();
+}
+
+static void testHandlerUnsubscribesNext()
+{
+    // chained third, second, first
+    subscribe(first);
+    subscribe(second);
+    subscribe(third);
+    third.unsubscribe = &second.subscription;
+    subscriptions.dispatch(tboiler(0x2D00));
+    CHECK_EQUAL(1, third.calls);
+    CHECK_EQUAL(0, second.calls);
+    // the rest of the chain was lost with the unsubscribed entry, the next response reaches it
+    subscriptions.dispatch(tboiler(0x2E00));
+    CHECK_EQUAL(0, second.calls);
+    CHECK_EQUAL(2, third.calls);
+    CHECK(first.calls > 0);
+    CHECK_EQUAL(0x2E00, first.response & 0xFFFF);
+    unsubscribeAll();
+}
+
+static void testUnsubscribedEntryReused()
+{
+    subscribe(first);
+    subscribe(second);
+    // the freed entry of first is taken for another ID
+    second.unsubscribe = &first.subscription;
+    second.subscribeId = OpenThermMessageID::Tdhw;
+    subscriptions.dispatch(tboiler(0x2D00));
+    CHECK_EQUAL(1, second.calls);
+    CHECK_EQUAL(0, first.calls);
+    CHECK(added.subscription != NULL);
+    CHECK_EQUAL(0, added.calls);
+
+    subscriptions.dispatch(OpenTherm::buildResponse(OpenThermMessageType::READ_ACK, OpenThermMessageID::Tdhw, 0x3000));
+    CHECK_EQUAL(1, added.calls);
+    CHECK_EQUAL(1, second.calls);
+    unsubscribeAll();
+}
+
+int main()
+{
+    testReset();
+    testHandlerUnsubscribesItself();
+    testHandlerUnsubscribesNext();
+    testUnsubscribedEntryReused();
+    return testResult();
+}
@@ -0,0 +1,151 @@
+/*
+test_table.cpp - Background reading of indexed data, see OpenThermTableReader
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTable.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+
+// answers requests with raw frames instead of the boiler
+OpenTherm raw(6, 7, true);
+static unsigned long rawRequest = 0;
+static unsigned long rawResponse = 0;
+
+static void handleRawRequest(unsigned long request, OpenThermResponseStatus status, void *)
+{
+    if (status == OpenThermResponseStatus::SUCCESS)
+    {
+        rawRequest = request;
+    }
+}
+
+static void processRaw()
+{
+    raw.process();
+    if (rawRequest != 0 && raw.isReady() && raw.sendResponse(rawResponse))
+    {
+        rawRequest = 0;
+    }
+}
+
+// TSP of 4 entries with value 0x10 + index, the index of rejected is answered with DATA_INVALID
+// and the index of misanswered with another index
+static int rejected = -1;
+static int misanswered = -1;
+
+static OpenThermMessageType handleBoilerRequest(OpenThermMessageType, OpenThermMessageID id, uint16_t &data, void *)
+{
+    if (id == OpenThermMessageID::TSP)
+    {
+        data = 0x0400;
+        return OpenThermMessageType::READ_ACK;
+    }
+    const byte index = data >> 8;
+    if (index == rejected)
+    {
+        return OpenThermMessageType::DATA_INVALID;
+    }
+    data = (uint16_t)((index == misanswered ? index + 1 : index) << 8) | (0x10 + index);
+    return OpenThermMessageType::READ_ACK;
+}
+
+static bool readTable(OpenThermTableReader &reader, unsigned long us)
+{
+    for (unsigned long i = 0; i < us && !reader.isComplete(); i += 1000)
+    {
+        loopback.run(1000);
+        reader.process();
+    }
+    return reader.isComplete();
+}
+
+static void testRejectedIndexIsSkipped()
+{
+    byte values[4] = {0, 0, 0, 0};
+    OpenThermTable table = OpenThermTableReader::transparentParameters(values, sizeof(values));
+    OpenThermTableReader reader(master, &table, 1);
+    reader.begin();
+    rejected = 2;
+    CHECK(readTable(reader, 5000000));
+    CHECK(table.state == OpenThermTableState::COMPLETE);
+    CHECK_EQUAL(1, table.skipped);
+    CHECK_EQUAL(0x10, values[0]);
+    CHECK_EQUAL(0x11, values[1]);
+    CHECK_EQUAL(0, values[2]);
+    CHECK_EQUAL(0x13, values[3]);
+    rejected = -1;
+}
+
+static void testMisansweredIndexIsSkipped()
+{
+    byte values[4] = {0, 0, 0, 0};
+    OpenThermTable table = OpenThermTableReader::transparentParameters(values, sizeof(values));
+    OpenThermTableReader reader(master, &table, 1);
+    reader.begin();
+    misanswered = 1;
+    // asked OPENTHERM_TABLE_RETRIES times, OPENTHERM_TABLE_RETRY_DELAY apart
+    CHECK(readTable(reader, 10000000));
+    CHECK(table.state == OpenThermTableState::COMPLETE);
+    CHECK_EQUAL(1, table.skipped);
+    CHECK_EQUAL(0, values[1]);
+    CHECK_EQUAL(0x13, values[3]);
+    misanswered = -1;
+}
+
+static void testUnknownDataId()
+{
+    byte values[4];
+    OpenThermTable table = OpenThermTableReader::faultHistory(values, sizeof(values));
+    OpenThermTableReader reader(master, &table, 1);
+    reader.begin();
+    CHECK(readTable(reader, 5000000));
+    CHECK(table.state == OpenThermTableState::UNSUPPORTED);
+}
+
+// UNKNOWN_DATA_ID with a wrong parity bit is a corrupted frame, not an answer
+static void testCorruptedUnknownDataIdIsRetried()
+{
+    byte values[4] = {0, 0, 0, 0};
+    OpenThermTable table = OpenThermTableReader::transparentParameters(values, sizeof(values));
+    OpenThermTableReader reader(master, &table, 1);
+    reader.begin();
+
+    OpenThermTestPin::link(3, 6);
+    OpenThermTestPin::link(7, 2);
+    rawResponse = OpenTherm::buildResponse(OpenThermMessageType::UNKNOWN_DATA_ID, OpenThermMessageID::TSP, 0) ^ 0x80000000;
+    loopback.tick = processRaw;
+    reader.process();
+    loopback.run(500000);
+    loopback.tick = NULL;
+    CHECK(table.state == OpenThermTableState::SIZE);
+    CHECK(OpenTherm::getMessageType(master.getLastResponse()) == OpenThermMessageType::UNKNOWN_DATA_ID);
+
+    boiler.connect(2, 3);
+    CHECK(readTable(reader, 5000000));
+    CHECK(table.state == OpenThermTableState::COMPLETE);
+    CHECK_EQUAL(0x12, values[2]);
+}
+
+int main()
+{
+    loopback.begin();
+    raw.begin();
+    OpenThermResponseListener listener = {handleRawRequest, NULL, NULL};
+    raw.addResponseListener(&listener);
+    boiler.setHandler(handleBoilerRequest);
+    boiler.setSupported(OpenThermMessageID::TSP, true);
+    boiler.setSupported(OpenThermMessageID::TSPindexTSPvalue, true);
+    boiler.enableHandler(OpenThermMessageID::TSP);
+    boiler.enableHandler(OpenThermMessageID::TSPindexTSPvalue);
+
+    testRejectedIndexIsSkipped();
+    testMisansweredIndexIsSkipped();
+    testUnknownDataId();
+    testCorruptedUnknownDataIdIsRetried();
+    return testResult();
+}
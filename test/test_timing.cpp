@@ -0,0 +1,75 @@
+/*
+test_timing.cpp - Adaptive response timeout, see OpenThermTiming
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+
+static OpenThermResponseStatus read()
+{
+    CHECK(master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0)));
+    loopback.run(1500000);
+    return master.getLastResponseStatus();
+}
+
+static void setSlaveDelay(unsigned long delay)
+{
+    OpenThermTiming timing;
+    timing.slaveDelay = delay;
+    boiler.slave.setTiming(timing);
+}
+
+// timeout is twice the peak response latency plus 20ms, limited to 100ms..responseTimeout
+static void testTimeoutGrowsAfterLostFrame()
+{
+    CHECK_EQUAL(1000000, master.getResponseTimeout());
+    setSlaveDelay(150000);
+    CHECK(read() == OpenThermResponseStatus::SUCCESS);
+    const unsigned long timeout = master.getResponseTimeout();
+    CHECK(timeout > 2 * 140000 + 20000 && timeout < 2 * 170000 + 20000);
+
+    // each lost frame doubles the peak, up to the configured timeout
+    boiler.disconnect();
+    CHECK(read() == OpenThermResponseStatus::TIMEOUT);
+    CHECK_EQUAL(2 * timeout - 20000, master.getResponseTimeout());
+    CHECK(read() == OpenThermResponseStatus::TIMEOUT);
+    CHECK_EQUAL(1000000, master.getResponseTimeout());
+    boiler.reconnect();
+}
+
+// faster answers decay the peak by 1/16 each, down to the 100ms floor
+static void testTimeoutDecaysToFloor()
+{
+    setSlaveDelay(20000);
+    unsigned long previous = master.getResponseTimeout();
+    int reads = 0;
+    while (reads < 60 && master.getResponseTimeout() > 100000)
+    {
+        CHECK(read() == OpenThermResponseStatus::SUCCESS);
+        CHECK(master.getResponseTimeout() <= previous);
+        previous = master.getResponseTimeout();
+        reads++;
+    }
+    CHECK_EQUAL(100000, master.getResponseTimeout());
+    CHECK(reads > 30);
+    CHECK(read() == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(100000, master.getResponseTimeout());
+}
+
+int main()
+{
+    loopback.begin();
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    OpenThermTiming timing;
+    timing.adaptiveTimeout = true;
+    master.setTiming(timing);
+
+    testTimeoutGrowsAfterLostFrame();
+    testTimeoutDecaysToFloor();
+    return testResult();
+}
@@ -0,0 +1,211 @@
+/*
+test_trace.cpp - Bus trace capture and replay, see OpenThermTrace
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTrace.h"
+#include "OpenThermTest.h"
+#include <stdlib.h>
+
+static OpenThermTraceRecord makeRecord(unsigned long frame, unsigned long delta)
+{
+    OpenThermTraceRecord record;
+    record.direction = OpenThermTraceDirection::SENT;
+    record.status = OpenThermResponseStatus::NONE;
+    record.frame = frame;
+    record.delta = delta;
+    return record;
+}
+
+static void testEncoding()
+{
+    uint8_t data[OpenThermTrace::MAX_RECORD_SIZE + 4];
+    memset(data, 0xAA, sizeof(data));
+    OpenThermTraceRecord decoded;
+
+    CHECK_EQUAL(6, OpenThermTrace::encode(data, makeRecord(0x00190000, 0)));
+    CHECK_EQUAL(6, OpenThermTrace::decode(data, sizeof(data), decoded));
+    CHECK_EQUAL(0x00190000, decoded.frame);
+    CHECK_EQUAL(0, decoded.delta);
+
+    CHECK_EQUAL(OpenThermTrace::MAX_RECORD_SIZE, OpenThermTrace::encode(data, makeRecord(0x80190000, 0xFFFFFFFFul)));
+    CHECK_EQUAL(OpenThermTrace::MAX_RECORD_SIZE, OpenThermTrace::decode(data, sizeof(data), decoded));
+    CHECK_EQUAL(0xFFFFFFFFul, decoded.delta);
+    CHECK_EQUAL(0x80190000, decoded.frame);
+    CHECK_EQUAL(0xAA, data[OpenThermTrace::MAX_RECORD_SIZE]);
+}
+
+// timestamps are unsigned long, 64 bit on the host
+static void testLongDelta()
+{
+    uint8_t buffer[64];
+    OpenThermTrace trace(buffer, sizeof(buffer));
+    const unsigned long start = (unsigned long)-1000;
+    trace.record(OpenThermTraceDirection::SENT, 0x00190000, OpenThermResponseStatus::NONE, start);
+    trace.record(OpenThermTraceDirection::RECEIVED, 0x40192D80, OpenThermResponseStatus::SUCCESS, start + 0x1234567890ul);
+    trace.record(OpenThermTraceDirection::SENT, 0x00190000, OpenThermResponseStatus::NONE, start + 0x1234567890ul + 100);
+    CHECK_EQUAL(6 + 10 + 6, trace.available());
+
+    OpenThermTraceRecord record;
+    CHECK(trace.read(record));
+    CHECK(trace.read(record));
+    CHECK(record.direction == OpenThermTraceDirection::RECEIVED);
+    CHECK(record.status == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(0x34567890, record.delta);
+    CHECK_EQUAL(0x40192D80, record.frame);
+    CHECK(trace.read(record));
+    CHECK_EQUAL(100, record.delta);
+    CHECK(!trace.read(record));
+}
+
+static void testDroppedRecordsAreRebased()
+{
+    // 30 bytes, room for 3 records with 5 byte deltas, rebased ones are 6 bytes
+    uint8_t buffer[31];
+    OpenThermTrace trace(buffer, sizeof(buffer));
+    unsigned long timestamp = 0;
+    for (unsigned long i = 0; i < 5; i++)
+    {
+        timestamp += 0x10000000ul + i;
+        trace.record(OpenThermTraceDirection::SENT, i, OpenThermResponseStatus::NONE, timestamp);
+    }
+    CHECK_EQUAL(2, trace.getDropped());
+
+    // the oldest record left lost its predecessor, the later ones keep their deltas
+    OpenThermTraceRecord record;
+    CHECK(trace.read(record));
+    CHECK_EQUAL(2, record.frame);
+    CHECK_EQUAL(0, record.delta);
+    CHECK(trace.read(record));
+    CHECK_EQUAL(3, record.frame);
+    CHECK_EQUAL(0x10000003ul, record.delta);
+    CHECK(trace.read(record));
+    CHECK_EQUAL(4, record.frame);
+    CHECK_EQUAL(0x10000004ul, record.delta);
+    CHECK(!trace.read(record));
+
+    // a record bigger than the free space replaces all records, including the one being read
+    uint8_t small[11];
+    OpenThermTrace single(small, sizeof(small));
+    single.record(OpenThermTraceDirection::SENT, 1, OpenThermResponseStatus::NONE, 0);
+    single.record(OpenThermTraceDirection::SENT, 2, OpenThermResponseStatus::NONE, 0x10000000ul);
+    CHECK_EQUAL(1, single.getDropped());
+    CHECK(single.read(record));
+    CHECK_EQUAL(2, record.frame);
+    CHECK_EQUAL(0, record.delta);
+}
+
+// the base Print reports no free space, such a stream gets OPENTHERM_FLUSH_CHUNK bytes per flush
+static void testFlushToStreamWithoutFreeSpace()
+{
+    uint8_t buffer[64];
+    OpenThermTrace trace(buffer, sizeof(buffer));
+    for (unsigned long i = 0; i < 4; i++)
+    {
+        trace.record(OpenThermTraceDirection::SENT, i, OpenThermResponseStatus::NONE, 0);
+    }
+    OpenThermTestOutput output;
+    CHECK_EQUAL(OPENTHERM_FLUSH_CHUNK, trace.flush(output));
+    CHECK_EQUAL(4 * 6 - OPENTHERM_FLUSH_CHUNK, trace.flush(output));
+    CHECK_EQUAL(0, trace.available());
+
+    OpenThermTraceRecord record;
+    size_t offset = 0;
+    for (unsigned long i = 0; i < 4; i++)
+    {
+        const byte size = OpenThermTrace::decode((const uint8_t *)output.text + offset, output.length - offset, record);
+        CHECK_EQUAL(6, size);
+        CHECK_EQUAL(i, record.frame);
+        offset += size;
+    }
+}
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+OpenTherm replayed(6, 7);
+
+struct Responses
+{
+    unsigned long frames[8];
+    OpenThermResponseStatus statuses[8];
+    unsigned long timestamps[8];
+    int count;
+};
+
+static void collect(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    Responses *responses = static_cast<Responses *>(context);
+    if (responses->count < 8)
+    {
+        responses->frames[responses->count] = response;
+        responses->statuses[responses->count] = status;
+        responses->timestamps[responses->count] = micros();
+        responses->count++;
+    }
+}
+
+static void testReplay()
+{
+    loopback.begin();
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    boiler.setValue(OpenThermMessageID::Status, 0x000A);
+    replayed.begin();
+
+    uint8_t buffer[256];
+    OpenThermTrace trace(buffer, sizeof(buffer));
+    master.setTrace(&trace);
+    Responses recorded = {};
+    OpenThermResponseListener recorder = {collect, &recorded, NULL};
+    master.addResponseListener(&recorder);
+
+    master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Status, 0x0300));
+    master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0));
+    loopback.run(500000);
+    // the boiler is disconnected
+    boiler.disconnect();
+    master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tret, 0));
+    loopback.run(1500000);
+    boiler.reconnect();
+    master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0));
+    loopback.run(500000);
+    master.setTrace(NULL);
+    CHECK_EQUAL(4, recorded.count);
+    CHECK(recorded.statuses[2] == OpenThermResponseStatus::TIMEOUT);
+
+    uint8_t data[256];
+    const size_t size = trace.readBytes(data, sizeof(data));
+    CHECK(size > 8 * 6);
+    CHECK_EQUAL(0, trace.available());
+
+    Responses replayedResponses = {};
+    OpenThermResponseListener player = {collect, &replayedResponses, NULL};
+    replayed.addResponseListener(&player);
+    OpenThermReplay replay(replayed);
+    replay.replay(data, size);
+
+    CHECK_EQUAL(recorded.count, replayedResponses.count);
+    for (int i = 0; i < recorded.count && i < replayedResponses.count; i++)
+    {
+        CHECK_EQUAL(recorded.frames[i], replayedResponses.frames[i]);
+        CHECK(recorded.statuses[i] == replayedResponses.statuses[i]);
+        // responses come at the recorded times
+        if (i > 0)
+        {
+            const long recordedGap = recorded.timestamps[i] - recorded.timestamps[i - 1];
+            const long replayedGap = replayedResponses.timestamps[i] - replayedResponses.timestamps[i - 1];
+            CHECK(labs(recordedGap - replayedGap) < 2000);
+        }
+    }
+}
+
+int main()
+{
+    testEncoding();
+    testLongDelta();
+    testDroppedRecordsAreRebased();
+    testFlushToStreamWithoutFreeSpace();
+    testReplay();
+    return testResult();
+}
@@ -0,0 +1,115 @@
+/*
+test_transmit.cpp - Timer driven transmission, see OpenTherm::setTransmitTimer
+Copyright 2023, Ihor Melnyk
+
+A fake 500us timer calls handleTimerInterrupt() of a master and a slave
+connected through loopback pins.
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+
+static bool timerRunning = false;
+static unsigned long timerStarted = 0;
+static int timerStarts = 0;
+
+static void startTimer()
+{
+    timerRunning = true;
+    timerStarted = micros();
+    timerStarts++;
+}
+
+static void stopTimer()
+{
+    timerRunning = false;
+}
+
+static unsigned long response = 0;
+static OpenThermResponseStatus responseStatus = OpenThermResponseStatus::NONE;
+static int responses = 0;
+
+static void handleResponse(unsigned long frame, OpenThermResponseStatus status, void *)
+{
+    response = frame;
+    responseStatus = status;
+    responses++;
+}
+
+// the timer fires every 500us after it was started
+static void tick()
+{
+    if (timerRunning && (micros() - timerStarted) % 500 == 0)
+    {
+        master.handleTimerInterrupt();
+        boiler.slave.handleTimerInterrupt();
+    }
+}
+
+static void run(unsigned long us)
+{
+    loopback.run(us, 10);
+}
+
+static void testRequestIsNotBlocking()
+{
+    const unsigned long request = OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0);
+    const unsigned long started = micros();
+    CHECK(master.sendRequestAsync(request));
+    // only the first half bit is sent by the caller, the rest by the timer
+    CHECK_EQUAL(started, micros());
+    CHECK(master.status == OpenThermStatus::REQUEST_SENDING_FIRST_HALF);
+    CHECK(timerRunning);
+
+    // 34 bits of 1ms
+    run(33990);
+    CHECK(master.status == OpenThermStatus::REQUEST_SENDING_FIRST_HALF || master.status == OpenThermStatus::REQUEST_SENDING_SECOND_HALF);
+    run(10);
+    CHECK(master.status == OpenThermStatus::RESPONSE_WAITING);
+    // stopped by the master, the slave starts it again to respond
+    CHECK(!timerRunning || timerStarts == 2);
+    run(200000);
+    CHECK(master.isReady());
+    CHECK(!timerRunning);
+}
+
+static void testConversation()
+{
+    const int starts = timerStarts;
+    responses = 0;
+    CHECK(master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0), handleResponse));
+    run(300000);
+    CHECK_EQUAL(1, responses);
+    CHECK(responseStatus == OpenThermResponseStatus::SUCCESS);
+    CHECK(OpenTherm::getMessageType(response) == OpenThermMessageType::READ_ACK);
+    CHECK(OpenTherm::getDataID(response) == OpenThermMessageID::Tboiler);
+    CHECK_EQUAL(0x2D80, response & 0xFFFF);
+    // one timer run for the request and one for the response
+    CHECK_EQUAL(starts + 2, timerStarts);
+
+    responses = 0;
+    CHECK(master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TSet, 0x3C00), handleResponse));
+    run(300000);
+    CHECK_EQUAL(1, responses);
+    CHECK(OpenTherm::getMessageType(response) == OpenThermMessageType::WRITE_ACK);
+    CHECK_EQUAL(0x3C00, boiler.getValue(OpenThermMessageID::TSet));
+    CHECK(!timerRunning);
+}
+
+int main()
+{
+    loopback.begin();
+    loopback.tick = tick;
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    boiler.setValue(OpenThermMessageID::TSet, 0, OpenThermDataAccess::READ_WRITE);
+    master.setTransmitTimer(startTimer, stopTimer);
+    boiler.slave.setTransmitTimer(startTimer, stopTimer);
+
+    testRequestIsNotBlocking();
+    testConversation();
+    return testResult();
+}
@@ -0,0 +1,89 @@
+/*
+test_write.cpp - Coalescing and deduplication of queued writes, see OpenTherm::enqueueWrite
+Copyright 2023, Ihor Melnyk
+*/
+
+#include "OpenTherm.h"
+#include "OpenThermTest.h"
+
+OpenThermLoopback loopback;
+OpenTherm &master = loopback.master;
+OpenThermTestBoiler &boiler = loopback.boiler;
+
+struct Result
+{
+    unsigned long response;
+    OpenThermResponseStatus status;
+    int calls;
+};
+
+static void handleResult(unsigned long response, OpenThermResponseStatus status, void *context)
+{
+    Result *result = static_cast<Result *>(context);
+    result->response = response;
+    result->status = status;
+    result->calls++;
+}
+
+// keeps the master busy, so the next requests wait in the queue
+static void sendRead()
+{
+    CHECK(master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0)));
+    CHECK(!master.isReady());
+}
+
+static void testQueuedWritesCoalesce()
+{
+    sendRead();
+    Result first = {}, second = {};
+    CHECK(master.enqueueWrite(OpenThermMessageID::TSet, 0x2800, handleResult, &first));
+    CHECK(master.enqueueWrite(OpenThermMessageID::TSet, 0x3000, handleResult, &second));
+    CHECK_EQUAL(1, master.getQueueDepth());
+    CHECK_EQUAL(1, first.calls);
+    CHECK(first.status == OpenThermResponseStatus::NONE);
+    loopback.run(1000000);
+    CHECK_EQUAL(1, second.calls);
+    CHECK(second.status == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(0x3000, boiler.getValue(OpenThermMessageID::TSet));
+}
+
+// e.g. a write forwarded by the gateway, whose thermostat waits for the answer
+static void testRequestsAreNotReplaced()
+{
+    sendRead();
+    Result forwarded = {}, written = {};
+    CHECK(master.enqueueRequest(OpenTherm::buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TSet, 0x2000), handleResult, &forwarded));
+    CHECK(master.enqueueWrite(OpenThermMessageID::TSet, 0x3800, handleResult, &written));
+    CHECK_EQUAL(2, master.getQueueDepth());
+    CHECK_EQUAL(0, forwarded.calls);
+    loopback.run(1000000);
+    CHECK_EQUAL(1, forwarded.calls);
+    CHECK(forwarded.status == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(0x2000, forwarded.response & 0xFFFF);
+    CHECK_EQUAL(1, written.calls);
+    CHECK(written.status == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(0x3800, boiler.getValue(OpenThermMessageID::TSet));
+}
+
+static void testAcknowledgedWriteIsSkipped()
+{
+    const unsigned long skipped = master.getWritesSkipped();
+    Result result = {};
+    CHECK(master.enqueueWrite(OpenThermMessageID::TSet, 0x3800, handleResult, &result));
+    CHECK_EQUAL(1, result.calls);
+    CHECK(result.status == OpenThermResponseStatus::SUCCESS);
+    CHECK_EQUAL(skipped + 1, master.getWritesSkipped());
+}
+
+int main()
+{
+    loopback.begin();
+    boiler.setFloat(OpenThermMessageID::Tboiler, 45.5);
+    boiler.setValue(OpenThermMessageID::TSet, 0, OpenThermDataAccess::WRITE);
+    master.setWriteRefresh(60000);
+
+    testQueuedWritesCoalesce();
+    testRequestsAreNotReplaced();
+    testAcknowledgedWriteIsSkipped();
+    return testResult();
+}
@@ -0,0 +1,73 @@
+#!/bin/sh
+# size_report.sh - RAM and flash usage of OpenTherm Library configurations
+#
+# Usage: tools/size_report.sh [fqbn] [sketch]
+# Defaults to Arduino UNO and the master example. Requires arduino-cli with the board core installed.
+#
+# Usage: tools/size_report.sh --host
+# Compiles the library sources with the host compiler (CXX, g++ by default) and prints
+# text, data and bss of all objects. Without arduino-cli this compares configurations,
+# absolute numbers and RAM usage differ on a board: program memory is ordinary memory
+# on the host, so strings are in text with or without PROGMEM.
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+FQBN=${1:-arduino:avr:uno}
+SKETCH=${2:-$ROOT/examples/OpenThermMaster_Demo}
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+MINIMAL="-DOPENTHERM_SLAVE=0 -DOPENTHERM_CALLBACKS=0 -DOPENTHERM_STRINGS=0 -DOPENTHERM_DISCOVERY=0"
+MINIMAL="$MINIMAL -DOPENTHERM_REQUEST_QUEUE_SIZE=1 -DOPENTHERM_CACHE_SIZE=1 -DOPENTHERM_RETRY_OVERRIDES=1"
+MINIMAL="$MINIMAL -DOPENTHERM_WRITE_CACHE_SIZE=1 -DOPENTHERM_HISTOGRAM_BUCKETS=1 -DOPENTHERM_EDGE_BUFFER_SIZE=0"
+
+host_report()
+{
+    name=$1
+    flags=$2
+    mkdir -p "$BUILD/$name"
+    for source in "$ROOT"/src/*.cpp; do
+        ${CXX:-g++} -std=gnu++11 -Os -DOPENTHERM_HOST $flags -I"$ROOT/src" \
+            -c "$source" -o "$BUILD/$name/$(basename "$source" .cpp).o" || {
+            printf '%-12s build failed\n' "$name"
+            return
+        }
+    done
+    size -t "$BUILD/$name"/*.o | tail -n 1 | {
+        read -r text data bss rest
+        printf '%-12s %8s %8s %8s  %s\n' "$name" "$text" "$data" "$bss" "$flags"
+    }
+}
+
+report()
+{
+    name=$1
+    flags=$2
+    output=$(arduino-cli compile --fqbn "$FQBN" --library "$ROOT" --build-path "$BUILD/$name" \
+        --build-property "compiler.cpp.extra_flags=$flags" "$SKETCH" 2>&1) || {
+        printf '%-12s build failed\n' "$name"
+        echo "$output" | grep -m 5 -i error
+        return
+    }
+    flash=$(echo "$output" | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p')
+    ram=$(echo "$output" | sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p')
+    printf '%-12s %8s %8s  %s\n' "$name" "$flash" "$ram" "$flags"
+}
+
+if [ "$1" = "--host" ]; then
+    echo "host $(${CXX:-g++} -dumpmachine)"
+    printf '%-12s %8s %8s %8s  %s\n' config text data bss flags
+    host_report default ""
+    host_report master "-DOPENTHERM_SLAVE=0"
+    host_report no-strings "-DOPENTHERM_SLAVE=0 -DOPENTHERM_CALLBACKS=0 -DOPENTHERM_STRINGS=0"
+    host_report minimal "$MINIMAL"
+    exit 0
+fi
+
+echo "$FQBN $(basename "$SKETCH")"
+printf '%-12s %8s %8s  %s\n' config flash ram flags
+report default ""
+report master "-DOPENTHERM_SLAVE=0"
+report no-strings "-DOPENTHERM_SLAVE=0 -DOPENTHERM_CALLBACKS=0 -DOPENTHERM_STRINGS=0"
+report minimal "$MINIMAL"